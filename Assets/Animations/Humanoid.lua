@@ -0,0 +1,8 @@
+-- Humanoid.lua
+-- Animations shared by every humanoid character
+
+local humanoid = AnimationSet.new()
+humanoid:add("idle", "GenericIdle")
+humanoid:add("walk", "GenericWalk")
+humanoid:add("death", "GenericDeath")
+return Resource_ANIMATIONSET, "Humanoid", humanoid
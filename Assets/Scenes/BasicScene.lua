@@ -17,29 +17,32 @@ local function onBegin()
   World.useCombatSystem()
   World.useSpellSystem()
 
+  -- Physics quality for this scene, lowered automatically under load
+  World.Physics.stepRate = 60
+  World.Physics.velocityIterations = 8
+  World.Physics.positionIterations = 3
+  World.Physics.minStepRate = 30
+
   -- Get window size
   size = Game.displaySize
 
   -- Spawn bottom of map
+  -- The ground is merged static geometry, the entity only draws it
   print("Spawning ground..")
+  local groundPos = Vector2f.new(size.x * 0.5, size.y * 0.9)
   local ground = World:createEntity()
   local groundTrans = ground:assignTransform()
-  local groundBody = ground:assignRigidBody()
-  groundTrans.position = Vector2f.new(size.x * 0.5, size.y * 0.9)
+  groundTrans.position = groundPos
   local sprite = ground:assignSprite()
   sprite.size = Vector2f.new(4000, 10)
   sprite.origin = Vector2f.new(0.5, 0)
   sprite:setSprite("BoxTexture")
-  local fixture = FixtureDef.new()
-  fixture:setShape(LineShape(-2000, 0, 2000, 0))
-  groundBody:addFixture(fixture)
+  World.Physics:addStaticEdge(groundPos.x - 2000, groundPos.y, groundPos.x + 2000, groundPos.y)
 
   -- Spawn the player
   print("Spawning player..")
   local pos = Vector2f.new(size.x * 0.5, size.y * 0.5)
-  player = spawnCharacter(pos, "MageTexture", 100)
-  local size = player:getSprite().size
-  player:getSprite().spritesheetAnchor = Vector2i.new(0, size.y * 5)
+  player = spawnCharacter(pos, Prefabs.mage)
   local possession = player:assignPossession()
   local camera = player:assignCamera()
   local stats = player:getStats()
@@ -62,14 +65,22 @@ local function onBegin()
   healthbarSprite.origin = Vector2f.new(0, 0)
   healthbarSprite.size = Vector2f.new(1000, 4) healthbarSprite.scale = Vector2f.new(1, 5)
 
+  -- Keep the healthbar showing the possessed entity's health, empty once it has died
+  World.registerSystem({
+    name = "HealthbarSystem",
+    query = { "Possession", "Combat" },
+    update = function(dt, view)
+      local length = 0
+      if view.count > 0 then length = view.Combat[1].currentHealth end
+      if length < 0 then length = 0 end
+      healthbarSprite.size.x = (length * (Game.displaySize.x * 0.3 - 50)) / 100
+      healthbarSprite:updateSprite()
+    end
+  })
+
   -- Spawn some plebs
   print("Spawning plebs..")
-  for i = 0, 10 do
-    local char = spawnCharacter(Vector2f.new(-2000 + (400 * i), Game.displaySize.y * 0.2), "OrcTexture", 50)
-    local size = char:getSprite().size
-    local rand = randomInt(0, 1)
-    char:getSprite().spritesheetAnchor = Vector2i.new(0, size.y * rand * 5)
-  end
+  World:spawn(Prefabs.orc, 11, Vector2f.new(-2000, Game.displaySize.y * 0.2), Vector2f.new(400, 0))
 
   -- Spawn text
   print("Rendering in-game text..")
@@ -82,16 +93,6 @@ local function onBegin()
   text:setRelativeOrigin(0.5, 0.5)
 end
 
--- On Update
-local function onUpdate(dt)
-  if (healthbarSprite ~= nil and player ~= nil and player:hasCombat()) then
-    local length = player:getCombat().currentHealth
-    if length < 0 then length = 0 end
-    healthbarSprite.size.x = (length * (Game.displaySize.x * 0.3 - 50)) / 100
-    healthbarSprite:updateSprite()
-  end
-end
-
 -- On Window events
 local function onWindowEvent(ev)
 
@@ -109,9 +110,21 @@ local function onWindowEvent(ev)
   end
 end
 
+-- While the scene's resources load before it is shown
+local function onLoading(progress)
+  local percent = progress * 100
+  print("Loading BasicScene.. " .. (percent - percent % 1) .. " percent")
+end
+
 -- Make and return the scene
 local scene = Scene.new()
 scene.onBegin = onBegin
-scene.onUpdate = onUpdate
 scene.onWindowEvent = onWindowEvent
+scene.onLoading = onLoading
+
+-- Resources loaded before the scene is shown, anything else used by onBegin is recorded
+scene.resources = {
+  "BoxTexture", "MageTexture", "OrcTexture", "HealthbarTexture", "EBGaramondFont",
+  "Humanoid", "GenericIdle", "GenericWalk", "GenericDeath", "LaunchBox", "Levitate", "Flight"
+}
 return Resource_SCENE, "BasicScene", scene
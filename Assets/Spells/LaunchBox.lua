@@ -26,12 +26,19 @@ local function spawnBox(x, y, scale)
   boxFixture.friction = 100
   spawnPos = Vector2f.new(x, y)
   boxTrans.position = spawnPos
-  boxBody:instantiate(bodyDef)
   boxFixture:setShape(BoxShape(60 * scale, 60 * scale))
-  boxBody:addFixture(boxFixture)
+  boxBody:instantiatePooled(bodyDef, boxFixture)
   return box
 end
 
+-- Hold it in place until it's launched
+local function holdBox()
+  while boxToThrow ~= nil do
+    boxToThrow:getRigidBody():warpTo(spawnPos)
+    waitFrames(1)
+  end
+end
+
 -- Spawn a box on spell cast
 local function createBox()
   local size = boxSize
@@ -41,13 +48,7 @@ local function createBox()
   boxToThrow = spawnBox(Game.mousePosition.x, Game.mousePosition.y, size)
   boxSize = boxSize + 0.5
   if boxSize > 3 then boxSize = 1 end
-end
-
--- Hold it in place
-local function holdBox()
-  if boxToThrow ~= nil then
-    boxToThrow:getRigidBody():warpTo(spawnPos)
-  end
+  World.startCoroutine(holdBox)
 end
 
 -- Fire on spell release
@@ -65,6 +66,5 @@ local name = "LaunchBox"
 local spell = Spell.new()
 spell.name = name
 spell.onCast= createBox
-spell.onPassive= holdBox
 spell.onRelease= launchBox
 return Resource_SPELL, name, spell
@@ -5,6 +5,14 @@
 local nullbody = nil
 local joint = nil
 
+-- Move the object towards the mouse until it's put down
+local function followMouse()
+  while joint do
+    joint.target = Vector2f.new(Game.mousePosition.x, Game.mousePosition.y)
+    waitFrames(1)
+  end
+end
+
 -- Pick up an object
 local function beginLevitation()
   if lastSpawnedBox ~= nil then
@@ -23,13 +31,7 @@ local function beginLevitation()
     def.maxForce = 500
     def.dampingRatio = 1
     joint = World.createMouseJoint(def)
-  end
-end
-
--- Change the destination for levitation
-local function updateDestination(self, dt)
-  if joint then
-    joint.target = Vector2f.new(Game.mousePosition.x, Game.mousePosition.y)
+    World.startCoroutine(followMouse)
   end
 end
 
@@ -46,6 +48,5 @@ local name = "Levitate"
 local spell = Spell.new()
 spell.name = name
 spell.onCast= beginLevitation
-spell.onPassive= updateDestination
 spell.onRelease= endLevitation
 return Resource_SPELL, name, spell
@@ -0,0 +1,24 @@
+-- Access.lua
+-- Component reads and writes through vectors, run with --benchmark-scripts
+-- Each frame makes 5000 accesses, divide the frame time by that for the cost of one
+
+-- Entities to read and write every frame
+local entities = {}
+for i = 1, 1000 do
+  local e = World:createEntity()
+  local trans = e:assignTransform()
+  trans.position = Vector2f.new(i, 0)
+  e:assignSprite()
+  entities[i] = e
+end
+
+-- Called every frame, getting components and moving vectors in and out of them
+return function(dt)
+  for i = 1, #entities do
+    local e = entities[i]
+    local trans = e:getTransform()
+    local pos = trans.position
+    trans.position = Vector2f.new(pos.x + 1, pos.y)
+    local size = e:getSprite().size
+  end
+end
@@ -0,0 +1,24 @@
+-- AccessNumbers.lua
+-- The same component reads and writes as Access.lua, passing vectors as two numbers
+-- Each frame makes 5000 accesses, divide the frame time by that for the cost of one
+
+-- Entities to read and write every frame
+local entities = {}
+for i = 1, 1000 do
+  local e = World:createEntity()
+  local trans = e:assignTransform()
+  trans:setPosition(i, 0)
+  e:assignSprite()
+  entities[i] = e
+end
+
+-- Called every frame, getting components and moving numbers in and out of them
+return function(dt)
+  for i = 1, #entities do
+    local e = entities[i]
+    local trans = e:getTransform()
+    local x, y = trans:getPosition()
+    trans:setPosition(x + 1, y)
+    local w, h = e:getSprite():getSize()
+  end
+end
@@ -0,0 +1,48 @@
+-- Scripts.lua
+-- Gameplay-like script work for comparing Lua builds, run with --benchmark-scripts
+
+-- Spawn characters the same way spawnCharacter does, without sprites or bodies
+local characters = {}
+for i = 1, 500 do
+  local char = World:createEntity()
+  local stats = char:assignStats()
+  local movement = stats.movement
+  movement.movementSpeed = 300
+  movement.canSprint = true
+  movement.sprintSpeedMult = 2
+  movement.flightSpeed = 100
+  local combat = stats.combat
+  combat.maxHealth = 100
+  local trans = char:assignTransform()
+  trans.position = Vector2f.new(i * 10, 0)
+  characters[i] = { entity = char, stats = stats, trans = trans, time = 0, health = 100 }
+end
+
+-- Passive spells, like a spell's onPassive
+local function hover(c, dt)
+  local pos = c.trans.position
+  c.trans.position = Vector2f.new(pos.x, pos.y + (c.time % 1 - 0.5) * dt)
+end
+local function drift(c, dt)
+  local pos = c.trans.position
+  local speed = c.stats.movement.movementSpeed
+  if c.stats.movement.canSprint then speed = speed * c.stats.movement.sprintSpeedMult end
+  c.trans.position = Vector2f.new(pos.x + speed * dt * 0.01, pos.y)
+end
+local function regenerate(c, dt)
+  c.health = c.health + dt
+  if c.health > c.stats.combat.maxHealth then c.health = c.stats.combat.maxHealth end
+end
+local spells = { hover, drift, regenerate }
+
+-- Called every frame, like a scene's onUpdate
+return function(dt)
+  local seconds = dt:asSeconds()
+  for i = 1, #characters do
+    local c = characters[i]
+    c.time = c.time + seconds
+    for j = 1, #spells do
+      spells[j](c, seconds)
+    end
+  end
+end
@@ -7,42 +7,59 @@ print("Running GameConfig.lua")
 -- Simply enable debug from the very beginning
 Game.debug = false
 
--- Convenience function for spawning a character
-function spawnCharacter(pos, texture, hp)
-  char = World:createEntity()
-  local stats = char:assignStats()
-  local movement = stats.movement
-  movement.movementSpeed = 300
-  movement.canSprint = true
-  movement.sprintSpeedMult = 2
-  movement.canJump = true
-  movement.canFly = false
-  movement.flightSpeed = 100
-  local combat = stats.combat
-  combat.maxHealth = hp
-  combat.deathDelay = 1
-  local sprite = char:assignSprite()
-  sprite.size = Vector2f.new(32, 32)
-  sprite.scale = Vector2f.new(4.2, 4.2)
-  sprite:setSprite(texture)
-  sprite:addAnimation("idle", "GenericIdle")
-  sprite:addAnimation("walk", "GenericWalk")
-  sprite:addAnimation("death", "GenericDeath")
-  sprite:playAnimation("idle", true)
-  local trans = char:assignTransform()
-  trans.position = pos
-  local body = char:assignRigidBody()
-  local bodyDef = BodyDef.new()
-  bodyDef.type = Physics_DYNAMICBODY
-  bodyDef.isFixedRotation = true
-  body:instantiate(bodyDef)
-  fixture = FixtureDef.new()
-  fixture:setShape(BoxShape(64, 128))
-  fixture.density = 100
-  fixture.friction = 10
-  body:addFixture(fixture)
-  body:makeGroundSensor()
-  return char
+-- Unused textures and fonts are released when they take more memory than this (MB)
+Resources.memoryBudget = 256
+Collector.frameRate = 60
+
+-- Scripts are stopped after running this long (ms), each callback and every callback in a frame
+Watchdog.milliseconds = 10
+Watchdog.frameMilliseconds = 20
+
+-- Names resolved once so prefabs don't look them up each time
+local Names = {
+  idle = Resources.id("idle"),
+  humanoid = Resources.id("Humanoid")
+}
+
+-- Describe a generic character, prefabs are compiled once and spawned with World:spawn
+local function characterPrefab(texture, hp, anchors)
+  return Prefab.new({
+    sprite = {
+      texture = texture,
+      animations = Names.humanoid,
+      animation = Names.idle,
+      size = Vector2f.new(32, 32),
+      scale = Vector2f.new(4.2, 4.2),
+      anchors = anchors
+    },
+    stats = {
+      movement = {
+        movementSpeed = 300,
+        canSprint = true,
+        sprintSpeedMult = 2,
+        canJump = true,
+        canFly = false,
+        flightSpeed = 100
+      },
+      combat = { maxHealth = hp, deathDelay = 1 }
+    },
+    rigidBody = {
+      isFixedRotation = true,
+      fixtures = {{ box = Vector2f.new(64, 128), density = 100, friction = 10 }},
+      groundSensor = true
+    }
+  })
+end
+
+-- Characters to spawn into scenes, orcs take one of two looks at random
+Prefabs = {
+  mage = characterPrefab("MageTexture", 100, { Vector2i.new(0, 160) }),
+  orc = characterPrefab("OrcTexture", 50, { Vector2i.new(0, 0), Vector2i.new(0, 160) })
+}
+
+-- Convenience function for spawning a single character
+function spawnCharacter(pos, prefab)
+  return World:spawn(prefab, 1, pos)[1]
 end
 
 local attemptMultiThread = true
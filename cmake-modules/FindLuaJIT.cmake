@@ -0,0 +1,73 @@
+# USAGE
+#
+# Finds LuaJIT, used in place of Lua when the USE_LUAJIT option is on.
+#
+# If LuaJIT is not installed in a standard path, you can use the LUAJITDIR or
+# LUAJIT_ROOT CMake (or environment) variables to tell CMake where to look for
+# LuaJIT.
+#
+#
+# OUTPUT
+#
+# This script defines the following variables:
+#   - LUAJIT_LIBRARY:     the path to the library to link to
+#   - LUAJIT_FOUND:       true if the LuaJIT library is found
+#   - LUAJIT_INCLUDE_DIR: the path where LuaJIT headers are located (the directory containing luajit.h)
+#
+#
+# EXAMPLE
+#
+# find_package(LuaJIT REQUIRED)
+# include_directories(${LUAJIT_INCLUDE_DIR})
+# add_executable(myapp ...)
+# target_link_libraries(myapp ${LUAJIT_LIBRARY} ...)
+
+set(LUAJIT_FOUND FALSE)
+
+find_path(
+	LUAJIT_INCLUDE_DIR
+	luajit.h
+	PATH_SUFFIXES
+		include/luajit-2.1
+		include/luajit-2.0
+		include/luajit
+		include
+	PATHS
+		/usr
+		/usr/local
+		${LUAJITDIR}
+		${LUAJIT_ROOT}
+		$ENV{LUAJITDIR}
+		$ENV{LUAJIT_ROOT}
+)
+
+find_library(
+	LUAJIT_LIBRARY
+	NAMES
+		luajit-5.1
+		luajit
+		lua51
+	PATH_SUFFIXES
+		lib
+		lib64
+	PATHS
+		/usr
+		/usr/local
+		${LUAJITDIR}
+		${LUAJIT_ROOT}
+		$ENV{LUAJITDIR}
+		$ENV{LUAJIT_ROOT}
+)
+
+if(NOT LUAJIT_INCLUDE_DIR OR NOT LUAJIT_LIBRARY)
+	if(LUAJIT_FIND_REQUIRED)
+		message(FATAL_ERROR "LuaJIT not found.")
+	elseif(NOT LUAJIT_FIND_QUIETLY)
+		message("LuaJIT not found.")
+	endif()
+else()
+	set(LUAJIT_FOUND true)
+	if (NOT LUAJIT_FIND_QUIETLY)
+		message(STATUS "LuaJIT found: ${LUAJIT_INCLUDE_DIR}")
+	endif()
+endif()
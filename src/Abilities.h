@@ -34,7 +34,8 @@ class Abilities : Component {
     Abilities(ECS::Entity* e) : Component(e) {}
 
     // Adds a spell or ability to the map
-    bool addAbility(unsigned slot, Spell spell) {
+    // Spells are shared with their resource so reloading it updates them
+    bool addAbility(unsigned slot, Spell* spell) {
       spells_[slot] = spell;
       return true;
     }
@@ -62,7 +63,7 @@ class Abilities : Component {
       }
 
       // Save the spell
-      spells_[slot] = *spell;
+      spells_[slot] = spell;
       return true;
     }
 
@@ -89,7 +90,7 @@ class Abilities : Component {
     // Passively casts a given spell in a slot
     void updateAllSpells(const sf::Time& dt) {
       for (auto i = spells_.begin(); i != spells_.end(); ++i) {
-        i->second.passive(owner_, dt);
+        i->second->passive(owner_, dt);
       }
     }
 
@@ -99,7 +100,7 @@ class Abilities : Component {
       // Try to find the spell in the map
       auto it = spells_.find(slot);
       if (it != spells_.end()) {
-        return &it->second;
+        return it->second;
       }
 
       // Otherwise return nullptr
@@ -110,7 +111,7 @@ class Abilities : Component {
     void showDebugInformation() {
       ImGui::NextColumn();
       for (auto i = spells_.begin(); i != spells_.end(); ++i) {
-        ImGui::Text("Spell: %u, %s", i->first, i->second.getName().c_str());
+        ImGui::Text("Spell: %u, %s", i->first, i->second->getName().c_str());
       }
       ImGui::PushItemWidth(-1);
       ImGui::PopItemWidth();
@@ -120,7 +121,7 @@ class Abilities : Component {
   private:
 
     // Spells this entity can cast
-    std::map<unsigned, Spell> spells_;
+    std::map<unsigned, Spell*> spells_;
 
 };
 
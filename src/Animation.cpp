@@ -3,6 +3,8 @@
 
 #include "Animation.h"
 
+#include <algorithm>
+
 // Constructor
 Animation::Animation() {}
 
@@ -18,8 +20,11 @@ Animation::getSize() const {
   return frames_.size();
 }
 
-// Get the nth frame
+// Get the nth frame, or the last one
+// Sprites may still be on a frame a reload took away
 const sf::IntRect& 
 Animation::getFrame(std::size_t n) const {
-  return frames_[n];
+  static const sf::IntRect noFrame;
+  if (frames_.empty()) { return noFrame; }
+  return frames_[std::min(n, frames_.size() - 1)];
 }
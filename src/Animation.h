@@ -12,10 +12,10 @@ class Animation {
   public:
 
     // Allow the Texture type to be made in Lua
-    static void registerAnimationType() {
+    static void registerAnimationType(sol::state_view lua) {
 
       // Register Animation type
-      Game::lua.new_usertype<Animation>("Animation",
+      lua.new_usertype<Animation>("Animation",
         sol::constructors<Animation()>(),
         "size", sol::property(&Animation::getSize),
         "getFrame", &Animation::getFrame,
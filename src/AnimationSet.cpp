@@ -0,0 +1,47 @@
+// AnimationSet.cpp
+// Resource mapping actions to animations, shared by every sprite using it
+
+#include "AnimationSet.h"
+
+// Constructor
+AnimationSet::AnimationSet() {}
+
+// Use an animation resource for an action
+void
+AnimationSet::addAnimation(NameID action, NameID animationName) {
+
+  // Replace the animation if the action already has one
+  for (auto& entry : entries_) {
+    if (entry.first == action) {
+      entry.second = animationName;
+      return;
+    }
+  }
+  entries_.emplace_back(action, animationName);
+}
+
+// Get the amount of actions with animations
+std::size_t
+AnimationSet::getSize() const {
+  return entries_.size();
+}
+
+// Look up the animation resources
+void
+AnimationSet::resolve() {
+  clips_.clear();
+  for (const auto& entry : entries_) {
+
+    // Attempts to get the resource
+    Resource& resource = ResourceManager::getResource(entry.second);
+    if (resource.getType() != Resource::Type::ANIMATION) {
+      Console::log("[Error] Could not add animation: %s\nNonexistant or incorrect resource type.",
+        StringTable::getString(entry.second).c_str());
+      continue;
+    }
+
+    // Action IDs index straight into the table
+    if (clips_.size() <= entry.first) { clips_.resize(entry.first + 1, nullptr); }
+    clips_[entry.first] = static_cast<const Animation*>(resource.get());
+  }
+}
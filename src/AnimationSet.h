@@ -0,0 +1,57 @@
+// AnimationSet.h
+// Resource mapping actions to animations, shared by every sprite using it
+
+#ifndef ANIMATIONSET_H
+#define ANIMATIONSET_H
+
+#include <utility>
+#include <vector>
+
+#include "Game.h"
+#include "Scripting.h"
+
+#include "Animation.h"
+
+// A shared table of which animation plays for each action
+class AnimationSet {
+  public:
+
+    // Allow the AnimationSet type to be made in Lua
+    static void registerAnimationSetType(sol::state_view lua) {
+
+      // Register AnimationSet type
+      lua.new_usertype<AnimationSet>("AnimationSet",
+        sol::constructors<AnimationSet()>(),
+        "size", sol::property(&AnimationSet::getSize),
+        "add", [](AnimationSet& self, const sol::object& action, const sol::object& animation) {
+          self.addAnimation(StringTable::fromLua(action), StringTable::fromLua(animation)); }
+      );
+    }
+
+    // Constructor
+    AnimationSet();
+
+    // Use an animation resource for an action
+    void addAnimation(NameID action, NameID animationName);
+
+    // Get the animation for an action, or null if the set doesn't have one
+    const Animation* getAnimation(NameID action) const {
+      return action < clips_.size() ? clips_[action] : nullptr;
+    }
+
+    // Get the amount of actions with animations
+    std::size_t getSize() const;
+
+    // Look up the animation resources, called once the set is loaded
+    void resolve();
+
+  private:
+
+    // Actions and the names of the animation resources they use
+    std::vector<std::pair<NameID, NameID>> entries_;
+
+    // Animations indexed by action ID, filled by resolve
+    std::vector<const Animation*> clips_;
+};
+
+#endif
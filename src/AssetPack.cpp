@@ -0,0 +1,320 @@
+// AssetPack.cpp
+// A single packed file of assets that is memory mapped at runtime
+
+#include "AssetPack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <SFML/Graphics/Image.hpp>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Avoid cyclic dependencies
+#include "Console.h"
+#include "Sol.h"
+
+// Initialise static members
+const char* AssetPack::data_ = nullptr;
+std::size_t AssetPack::size_ = 0;
+std::vector<char> AssetPack::buffer_;
+std::unordered_map<std::string, AssetPack::Entry> AssetPack::entries_;
+
+// Identifies pack files
+static const char packMagic[4] = { 'R', 'P', 'A', 'K' };
+// Scripts are stored as bytecode, which LuaJIT can't share with Lua
+#if defined(SOL_LUAJIT) && SOL_LUAJIT
+static const sf::Uint32 packVersion = 0x10001;
+#else
+static const sf::Uint32 packVersion = 1;
+#endif
+
+// Data is aligned so that it can be used in place
+static const std::size_t packAlignment = 16;
+
+// Size of an index entry, not including the path
+static const std::size_t indexEntrySize = sizeof(sf::Uint16) + sizeof(sf::Uint8) +
+  2 * sizeof(sf::Uint32) + 2 * sizeof(sf::Uint64);
+
+// Write plain data to a binary stream
+template <typename T> static void
+writeValue(std::ostream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Read plain data from memory, moving the cursor forwards
+template <typename T> static bool
+readValue(const char*& cursor, const char* end, T& value) {
+  if (cursor + sizeof(T) > end) { return false; }
+  std::memcpy(&value, cursor, sizeof(T));
+  cursor += sizeof(T);
+  return true;
+}
+
+// Pack every file in a directory into a single file
+bool
+AssetPack::build(const std::string& dir, const std::string& fp) {
+
+  // An asset waiting to be written
+  struct PendingEntry {
+    std::string path;
+    Kind kind;
+    sf::Uint32 width = 0;
+    sf::Uint32 height = 0;
+    std::string data;
+    sf::Uint64 offset = 0;
+  };
+
+  // Declare that we're packing
+  Console::log("Packing assets from '%s' into '%s'..", dir.c_str(), fp.c_str());
+
+  // Scripts are compiled in a state of their own, nothing is run
+  sol::state lua;
+  std::vector<PendingEntry> pending;
+  for (const auto& file : std::filesystem::recursive_directory_iterator(dir)) {
+    if (!file.is_regular_file()) { continue; }
+    PendingEntry entry;
+    entry.path = normalise(file.path().generic_string());
+    std::string ext = file.path().extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+    // Store scripts as bytecode
+    if (ext == ".lua") {
+      sol::load_result loaded = lua.load_file(file.path().string());
+      if (!loaded.valid()) {
+        sol::error err = loaded;
+        Console::log("[Error] Could not compile %s:\n> %s", entry.path.c_str(), err.what());
+        return false;
+      }
+      sol::unsafe_function chunk = loaded.get<sol::unsafe_function>();
+      const sol::bytecode bytecode = chunk.dump();
+      entry.kind = Kind::SCRIPT;
+      entry.data.assign(reinterpret_cast<const char*>(bytecode.data()), bytecode.size());
+    }
+
+    // Store images as raw pixels so they don't need decoding
+    else if (ext == ".png" || ext == ".jpg" || ext == ".bmp" || ext == ".tga") {
+      sf::Image image;
+      if (!image.loadFromFile(file.path().string())) {
+        Console::log("[Error] Could not decode image %s.", entry.path.c_str());
+        return false;
+      }
+      entry.kind = Kind::IMAGE;
+      entry.width = image.getSize().x;
+      entry.height = image.getSize().y;
+      entry.data.assign(reinterpret_cast<const char*>(image.getPixelsPtr()),
+        entry.width * entry.height * 4);
+    }
+
+    // Store everything else as it is
+    else {
+      std::ifstream input(file.path(), std::ios::binary);
+      entry.kind = Kind::RAW;
+      entry.data.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    }
+    pending.push_back(entry);
+  }
+
+  // Work out where each entry's data will go
+  std::size_t offset = sizeof(packMagic) + 2 * sizeof(sf::Uint32);
+  for (const auto& entry : pending) {
+    offset += indexEntrySize + entry.path.size();
+  }
+  for (auto& entry : pending) {
+    offset = (offset + packAlignment - 1) / packAlignment * packAlignment;
+    entry.offset = offset;
+    offset += entry.data.size();
+  }
+
+  // Write the header and index
+  std::ofstream output(fp, std::ios::binary | std::ios::trunc);
+  if (!output.is_open()) {
+    Console::log("[Error] Could not open %s for writing.", fp.c_str());
+    return false;
+  }
+  output.write(packMagic, sizeof(packMagic));
+  writeValue<sf::Uint32>(output, packVersion);
+  writeValue<sf::Uint32>(output, pending.size());
+  for (const auto& entry : pending) {
+    writeValue<sf::Uint16>(output, entry.path.size());
+    output.write(entry.path.data(), entry.path.size());
+    writeValue<sf::Uint8>(output, entry.kind);
+    writeValue<sf::Uint32>(output, entry.width);
+    writeValue<sf::Uint32>(output, entry.height);
+    writeValue<sf::Uint64>(output, entry.offset);
+    writeValue<sf::Uint64>(output, entry.data.size());
+  }
+
+  // Write the data with padding in between
+  for (const auto& entry : pending) {
+    const std::size_t padding = entry.offset - static_cast<std::size_t>(output.tellp());
+    output.write(std::string(padding, '\0').data(), padding);
+    output.write(entry.data.data(), entry.data.size());
+  }
+
+  // Report
+  Console::log("Packed %lu assets into %s (%.1fKB).",
+    pending.size(), fp.c_str(), offset / 1024.f);
+  return output.good();
+}
+
+// Map a pack into memory
+bool
+AssetPack::open(const std::string& fp) {
+
+  // Only one pack at a time
+  close();
+
+#ifndef _WIN32
+
+  // Map the file
+  const int fd = ::open(fp.c_str(), O_RDONLY);
+  if (fd < 0) {
+    Console::log("[Error] Could not open asset pack %s.", fp.c_str());
+    return false;
+  }
+  struct stat info;
+  void* mapped = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    Console::log("[Error] Could not map asset pack %s.", fp.c_str());
+    return false;
+  }
+  data_ = static_cast<const char*>(mapped);
+  size_ = info.st_size;
+
+#else
+
+  // Read the whole file instead
+  std::ifstream input(fp, std::ios::binary);
+  if (!input.is_open()) {
+    Console::log("[Error] Could not open asset pack %s.", fp.c_str());
+    return false;
+  }
+  buffer_.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+
+#endif
+
+  // Find where everything is
+  if (!readIndex(fp)) {
+    close();
+    return false;
+  }
+  Console::log("Using %lu packed assets from %s.", entries_.size(), fp.c_str());
+  return true;
+}
+
+// Check whether any file in a directory was changed after the pack was built
+// A missing directory means the pack is all there is, so it can't be out of date
+bool
+AssetPack::isOutOfDate(const std::string& fp, const std::string& dir) {
+  std::error_code error;
+  const auto built = std::filesystem::last_write_time(fp, error);
+  if (error || !std::filesystem::is_directory(dir, error)) { return false; }
+  for (const auto& file : std::filesystem::recursive_directory_iterator(dir, error)) {
+    if (file.is_regular_file(error) && file.last_write_time(error) > built) { return true; }
+  }
+  return false;
+}
+
+// Unmap the pack
+void
+AssetPack::close() {
+#ifndef _WIN32
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+#endif
+  buffer_.clear();
+  entries_.clear();
+  data_ = nullptr;
+  size_ = 0;
+}
+
+// Check whether a pack is open
+bool
+AssetPack::isOpen() {
+  return data_ != nullptr;
+}
+
+// Find an entry by the path it had before packing
+const AssetPack::Entry*
+AssetPack::find(const std::string& path) {
+  if (data_ == nullptr) { return nullptr; }
+  auto it = entries_.find(normalise(path));
+  return it != entries_.end() ? &it->second : nullptr;
+}
+
+// Get the paths of every script inside a directory
+std::vector<std::string>
+AssetPack::getScripts(const std::string& dir) {
+  std::string prefix = normalise(dir);
+  if (!prefix.empty() && prefix.back() != '/') { prefix += '/'; }
+  std::vector<std::string> scripts;
+  for (const auto& entry : entries_) {
+    if (entry.second.kind == Kind::SCRIPT && entry.first.compare(0, prefix.size(), prefix) == 0) {
+      scripts.push_back(entry.first);
+    }
+  }
+
+  // Keep the order the same between runs
+  std::sort(scripts.begin(), scripts.end());
+  return scripts;
+}
+
+// Make paths comparable no matter how they were written
+std::string
+AssetPack::normalise(const std::string& path) {
+  return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+// Read the header and index of the mapped file
+bool
+AssetPack::readIndex(const std::string& fp) {
+
+  // Check the header
+  const char* cursor = data_;
+  const char* end = data_ + size_;
+  char magic[4];
+  sf::Uint32 version = 0, count = 0;
+  if (!readValue(cursor, end, magic) || !std::equal(magic, magic + 4, packMagic) ||
+    !readValue(cursor, end, version) || version != packVersion ||
+    !readValue(cursor, end, count)) {
+    Console::log("[Error] %s is not a valid asset pack.", fp.c_str());
+    return false;
+  }
+
+  // Read every entry
+  for (sf::Uint32 i = 0; i < count; ++i) {
+    sf::Uint16 length = 0;
+    sf::Uint8 kind = 0;
+    sf::Uint32 width = 0, height = 0;
+    sf::Uint64 offset = 0, size = 0;
+    if (!readValue(cursor, end, length) || cursor + length > end) {
+      Console::log("[Error] Asset pack %s is truncated.", fp.c_str());
+      return false;
+    }
+    const std::string path(cursor, length);
+    cursor += length;
+    if (!readValue(cursor, end, kind) || !readValue(cursor, end, width) ||
+      !readValue(cursor, end, height) || !readValue(cursor, end, offset) ||
+      !readValue(cursor, end, size) || offset + size > size_) {
+      Console::log("[Error] Asset pack %s is truncated.", fp.c_str());
+      return false;
+    }
+    entries_[path] = { static_cast<Kind>(kind), data_ + offset, size, width, height };
+  }
+  return true;
+}
@@ -0,0 +1,76 @@
+// AssetPack.h
+// A single packed file of assets that is memory mapped at runtime
+
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <SFML/Config.hpp>
+
+// Static class to build and read packed asset files
+class AssetPack {
+  public:
+
+    // How an entry's data is stored
+    enum Kind : sf::Uint8 {
+      RAW,
+      SCRIPT,
+      IMAGE
+    };
+
+    // An asset stored in the pack, data points straight into the mapped file
+    struct Entry {
+      Kind kind;
+      const char* data;
+      std::size_t size;
+      unsigned width;
+      unsigned height;
+    };
+
+    // Pack every file in a directory into a single file
+    // Scripts are precompiled and images are stored decoded
+    static bool build(const std::string& dir, const std::string& fp);
+
+    // Map a pack into memory
+    static bool open(const std::string& fp);
+
+    // Check whether any file in a directory was changed after the pack was built
+    static bool isOutOfDate(const std::string& fp, const std::string& dir);
+
+    // Unmap the pack, anything pointing into it must be released first
+    static void close();
+
+    // Check whether a pack is open
+    static bool isOpen();
+
+    // Find an entry by the path it had before packing
+    static const Entry* find(const std::string& path);
+
+    // Get the paths of every script inside a directory
+    static std::vector<std::string> getScripts(const std::string& dir);
+
+  private:
+
+    // Start of the mapped file
+    static const char* data_;
+
+    // Size of the mapped file
+    static std::size_t size_;
+
+    // Holds the file on platforms without mmap
+    static std::vector<char> buffer_;
+
+    // Index of entries by path
+    static std::unordered_map<std::string, Entry> entries_;
+
+    // Make paths comparable no matter how they were written
+    static std::string normalise(const std::string& path);
+
+    // Read the header and index of the mapped file
+    static bool readIndex(const std::string& fp);
+};
+
+#endif
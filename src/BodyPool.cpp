@@ -0,0 +1,180 @@
+// BodyPool.cpp
+// Recycles b2Bodys and their fixtures for commonly spawned shapes
+
+#include "BodyPool.h"
+
+#include <tuple>
+
+// Define statics
+const std::size_t BodyPool::maxPerArchetype = 64;
+
+// Allow archetypes to be used as keys
+bool
+BodyArchetype::operator<(const BodyArchetype& other) const {
+  return std::tie(bodyType, shapeType, vertexCount, radius, vertices,
+      density, friction, restitution, isSensor, fixtureType) <
+    std::tie(other.bodyType, other.shapeType, other.vertexCount, other.radius, other.vertices,
+      other.density, other.friction, other.restitution, other.isSensor, other.fixtureType);
+}
+
+// Work out the archetype of a body, returns an invalid one if not poolable
+BodyArchetype
+BodyPool::makeArchetype(const b2BodyDef& bodyDef, const b2FixtureDef* fixtureDef) {
+  BodyArchetype archetype;
+
+  // Bodies without fixtures are always poolable
+  if (fixtureDef == nullptr) {
+    archetype.bodyType = bodyDef.type;
+    return archetype;
+  }
+
+  // Only simple shapes can be compared cheaply
+  const b2Shape* shape = fixtureDef->shape;
+  if (shape == nullptr) { return archetype; }
+  if (shape->GetType() == b2Shape::e_polygon) {
+    const auto* polygon = static_cast<const b2PolygonShape*>(shape);
+    archetype.vertexCount = polygon->m_count;
+    for (int32 i = 0; i < polygon->m_count; ++i) {
+      archetype.vertices[2 * i] = polygon->m_vertices[i].x;
+      archetype.vertices[2 * i + 1] = polygon->m_vertices[i].y;
+    }
+  }
+  else if (shape->GetType() == b2Shape::e_circle) {
+    const auto* circle = static_cast<const b2CircleShape*>(shape);
+    archetype.vertexCount = 1;
+    archetype.vertices[0] = circle->m_p.x;
+    archetype.vertices[1] = circle->m_p.y;
+  }
+  else {
+    return archetype;
+  }
+
+  // Fill in the rest of the description
+  archetype.bodyType = bodyDef.type;
+  archetype.shapeType = shape->GetType();
+  archetype.radius = shape->m_radius;
+  archetype.density = fixtureDef->density;
+  archetype.friction = fixtureDef->friction;
+  archetype.restitution = fixtureDef->restitution;
+  archetype.isSensor = fixtureDef->isSensor;
+  archetype.fixtureType = (long)fixtureDef->userData;
+  return archetype;
+}
+
+// Constructor
+BodyPool::BodyPool(b2World* world)
+  : world_(world)
+  , pooledCount_(0)
+  , reuseCount_(0) {
+}
+
+// Get a body matching the definitions, reusing an old one where possible
+b2Body*
+BodyPool::acquire(const b2BodyDef& bodyDef, const b2FixtureDef* fixtureDef, BodyArchetype& archetype) {
+
+  // Try to find a deactivated body of the same archetype
+  archetype = makeArchetype(bodyDef, fixtureDef);
+  if (archetype.isValid()) {
+    auto it = freeBodies_.find(archetype);
+    if (it != freeBodies_.end() && !it->second.empty()) {
+      b2Body* body = it->second.back();
+      it->second.pop_back();
+      --pooledCount_;
+      ++reuseCount_;
+      resetBody(body, bodyDef);
+      return body;
+    }
+  }
+
+  // Otherwise create a brand new body
+  b2Body* body = world_->CreateBody(&bodyDef);
+  if (fixtureDef != nullptr) {
+    body->CreateFixture(fixtureDef);
+  }
+  return body;
+}
+
+// Hand a body back to the pool, or queue it for destruction
+void
+BodyPool::release(b2Body* body, const BodyArchetype& archetype) {
+
+  // Easy out
+  if (body == nullptr) { return; }
+
+  // Destroy bodies we can't keep
+  if (!archetype.isValid()) {
+    dispose(body);
+    return;
+  }
+
+  // Destroy bodies we don't want to keep
+  auto& bodies = freeBodies_[archetype];
+  if (bodies.size() >= maxPerArchetype) {
+    dispose(body);
+    return;
+  }
+
+  // Detach the body from its owner and anything it is connected to
+  body->SetUserData(nullptr);
+  while (b2JointEdge* edge = body->GetJointList()) {
+    world_->DestroyJoint(edge->joint);
+  }
+
+  // Take the body out of the simulation until it is needed again
+  body->SetActive(false);
+  bodies.push_back(body);
+  ++pooledCount_;
+}
+
+// Queue a body to be destroyed on the next flush
+void
+BodyPool::dispose(b2Body* body) {
+  if (body != nullptr) {
+    body->SetUserData(nullptr);
+    disposeList_.push_back(body);
+  }
+}
+
+// Destroy all queued bodies
+void
+BodyPool::flush() {
+  for (auto* body : disposeList_) {
+    world_->DestroyBody(body);
+  }
+  disposeList_.clear();
+}
+
+// Destroy all pooled bodies
+void
+BodyPool::clear() {
+  for (auto& entry : freeBodies_) {
+    for (auto* body : entry.second) {
+      world_->DestroyBody(body);
+    }
+  }
+  freeBodies_.clear();
+  pooledCount_ = 0;
+}
+
+// Get the amount of bodies waiting to be reused
+std::size_t
+BodyPool::getPooledCount() const {
+  return pooledCount_;
+}
+
+// Bring a pooled body back to the state described by a definition
+void
+BodyPool::resetBody(b2Body* body, const b2BodyDef& def) {
+  body->SetActive(def.active);
+  body->SetTransform(def.position, def.angle);
+  body->SetFixedRotation(def.fixedRotation);
+  body->SetLinearVelocity(def.linearVelocity);
+  body->SetAngularVelocity(def.angularVelocity);
+  body->SetLinearDamping(def.linearDamping);
+  body->SetAngularDamping(def.angularDamping);
+  body->SetGravityScale(def.gravityScale);
+  body->SetBullet(def.bullet);
+  body->SetSleepingAllowed(def.allowSleep);
+  body->SetAwake(def.awake);
+  body->SetUserData(def.userData);
+}
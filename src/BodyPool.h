@@ -0,0 +1,94 @@
+// BodyPool.h
+// Recycles b2Bodys and their fixtures for commonly spawned shapes
+
+#ifndef BODYPOOL_H
+#define BODYPOOL_H
+
+#include <array>
+#include <map>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+// Describes a body with at most one fixture so it can be reused
+struct BodyArchetype {
+
+  // Body settings that cannot be cheaply changed on reuse
+  int bodyType = -1;
+
+  // Shape of the only fixture, -1 if there is no fixture
+  int shapeType = -1;
+  int32 vertexCount = 0;
+  float radius = 0.f;
+  std::array<float, 2 * b2_maxPolygonVertices> vertices {};
+
+  // Fixture settings
+  float density = 0.f;
+  float friction = 0.f;
+  float restitution = 0.f;
+  bool isSensor = false;
+  long fixtureType = 0;
+
+  // Whether this archetype can be pooled at all
+  bool isValid() const { return bodyType >= 0; }
+
+  // Allow archetypes to be used as keys
+  bool operator<(const BodyArchetype& other) const;
+};
+
+// Keeps deactivated bodies around instead of destroying them
+class BodyPool {
+  public:
+
+    // Most bodies to keep per archetype before destroying them
+    static const std::size_t maxPerArchetype;
+
+    // Work out the archetype of a body, returns an invalid one if not poolable
+    static BodyArchetype makeArchetype(const b2BodyDef& bodyDef, const b2FixtureDef* fixtureDef);
+
+    // Constructor
+    BodyPool(b2World* world);
+
+    // Get a body matching the definitions, reusing an old one where possible
+    b2Body* acquire(const b2BodyDef& bodyDef, const b2FixtureDef* fixtureDef, BodyArchetype& archetype);
+
+    // Hand a body back to the pool, or queue it for destruction
+    void release(b2Body* body, const BodyArchetype& archetype);
+
+    // Queue a body to be destroyed on the next flush
+    void dispose(b2Body* body);
+
+    // Destroy all queued bodies, call once per step outside of b2World::Step
+    void flush();
+
+    // Destroy all pooled bodies
+    void clear();
+
+    // Get the amount of bodies waiting to be reused
+    std::size_t getPooledCount() const;
+
+    // Get how many acquisitions were served from the pool
+    unsigned getReuseCount() const { return reuseCount_; }
+
+  private:
+
+    // The world bodies belong to
+    b2World* const world_;
+
+    // Deactivated bodies ready to be reused
+    std::map<BodyArchetype, std::vector<b2Body*>> freeBodies_;
+
+    // Bodies to destroy on the next flush
+    std::vector<b2Body*> disposeList_;
+
+    // Amount of bodies currently in freeBodies_
+    std::size_t pooledCount_;
+
+    // Amount of bodies that didn't need to be created
+    unsigned reuseCount_;
+
+    // Bring a pooled body back to the state described by a definition
+    void resetBody(b2Body* body, const b2BodyDef& def);
+};
+
+#endif
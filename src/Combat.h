@@ -58,7 +58,8 @@ class Combat : Component {
     // Constructor
     Combat(ECS::Entity* e)
       : Component(e) 
-      , currentHealth_(1) {
+      , currentHealth_(1)
+      , isDead_(false) {
     }
 
     // Combat stats
@@ -72,9 +73,17 @@ class Combat : Component {
     // Go back to full health
     int resetHealthToFull() {
       currentHealth_ = stats.maxHealth;
+      isDead_ = false;
       return currentHealth_;
     }
 
+    // Mark this entity as dead, returns false if it already was
+    bool markDead() {
+      if (isDead_) { return false; }
+      isDead_ = true;
+      return true;
+    }
+
     // Deal damage via fall damage or collision boxes
     int dealImpactDamage(double impact) {
       impact -= 15.f;
@@ -118,6 +127,9 @@ class Combat : Component {
     // Current health
     int currentHealth_;
 
+    // Whether the death has been handled
+    bool isDead_;
+
 };
 
 
@@ -11,6 +11,7 @@
 #include "Possession.h"
 #include "Sprite.h"
 #include "Expire.h"
+#include "ScriptEvents.h"
 
 // Monitor health's of entities
 class CombatSystem : public ECS::EntitySystem {
@@ -40,12 +41,18 @@ class CombatSystem : public ECS::EntitySystem {
         // If the entity has died
         if (c->getCurrentHealth() <= 0) {
 
+          // Let scripts know once
+          if (c->markDead()) {
+            world->emit<DeathEvent>({e});
+          }
+
           // Play death animation if possible
           if (e->has<Sprite>()) {
 
             // Get the sprite and play a death animation
             auto sprite = e->get<Sprite>();
-            sprite->playAnimation("death");
+            static const NameID death = StringTable::intern("death");
+            sprite->playAnimation(death);
 
             // If desired, kill the entity after the animation
             if (c->stats.deleteOnDeath &&
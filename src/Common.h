@@ -4,6 +4,11 @@
 #ifndef COMMON_H
 #define COMMON_H
 
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <string>
+
 #include "ECS.h"
 #include "Sol.h"
 
@@ -22,6 +27,69 @@ class Component {
     ECS::Entity* const owner_;
 };
 
+// Fixed size history of values for plotting with ImGui
+class RollingHistory {
+  public:
+
+    // How many values are kept
+    static const int capacity = 120;
+
+    // Add a value, replacing the oldest one
+    void push(float value) {
+      values_[offset_] = value;
+      offset_ = (offset_ + 1) % capacity;
+      if (count_ < capacity) { ++count_; }
+    }
+
+    // Get the most recent value
+    float latest() const {
+      return count_ > 0 ? values_[(offset_ + capacity - 1) % capacity] : 0.f;
+    }
+
+    // Get the average of the stored values
+    float average() const {
+      float total = 0.f;
+      for (int i = 0; i < count_; ++i) { total += values_[i]; }
+      return count_ > 0 ? total / count_ : 0.f;
+    }
+
+    // Get the largest stored value
+    float max() const {
+      float largest = 0.f;
+      for (int i = 0; i < count_; ++i) { largest = std::max(largest, values_[i]); }
+      return largest;
+    }
+
+    // Draw as a line graph with the latest, average and max overlaid
+    void plotLines(const char* label, const char* format = "%.3f") const {
+      ImGui::PlotLines(label, values_, capacity, offset_, makeOverlay(format).c_str(), 0.f, FLT_MAX, ImVec2(0, 40));
+    }
+
+    // Draw as a histogram with the latest, average and max overlaid
+    void plotHistogram(const char* label, const char* format = "%.0f") const {
+      ImGui::PlotHistogram(label, values_, capacity, offset_, makeOverlay(format).c_str(), 0.f, FLT_MAX, ImVec2(0, 40));
+    }
+
+  private:
+
+    // Stored values
+    float values_[capacity] = {};
+
+    // Where the next value will be written
+    int offset_ = 0;
+
+    // How many values have been written
+    int count_ = 0;
+
+    // Describe the values in text
+    std::string makeOverlay(const char* format) const {
+      const std::string fmt = std::string("last ") + format + ", avg " + format + ", max " + format;
+      char buf[128];
+      snprintf(buf, sizeof(buf), fmt.c_str(), latest(), average(), max());
+      return std::string(buf);
+    }
+};
+
 // ImGui colour picker widget
 inline sf::Color 
 showColourPicker(sf::Color colour, const std::string& popupName = "picker") {
@@ -3,8 +3,11 @@
 
 #include "Console.h"
 
+#include <mutex>
+
 // Avoid cyclic dependencies
 #include "Game.h"
+#include "ScriptWatchdog.h"
 
 // Initialise static variables
 char Console::InputBuf[256];
@@ -17,6 +20,9 @@ bool Console::autoScroll_;
 bool Console::scrollToBottom_;
 bool Console::outputToTerminal_ = false;
 
+// Resources may log from worker threads
+static std::mutex logMutex;
+
 // Start the console
 void
 Console::initialise(bool outputToTerminal) {
@@ -190,6 +196,7 @@ Console::log(const char* fmt, ...) {
   va_end(args);
 
   // Duplicate the string into a message
+  std::lock_guard<std::mutex> lock(logMutex);
   auto msg = Strdup(buf);
   items_.push_back(msg);
 
@@ -249,6 +256,7 @@ Console::execCommand(const char* command_line) {
 
   // Otherwise, run the command
   else {
+    ScriptWatchdog::Budget budget("Console command", ScriptWatchdog::getLoadingLimits());
     sol::protected_function_result result = Game::lua.script(command, sol::script_pass_on_error);
     if (!result.valid()) {
       sol::error err = result;
@@ -66,7 +66,8 @@ ControlSystem::update(ECS::World* world, const sf::Time& dt) {
         auto s = e->get<Sprite>();
         if (s.isValid()) {
           s->flipX = inputAxis.x < 0;
-          s->playAnimation("walk");
+          static const NameID walk = StringTable::intern("walk");
+          s->playAnimation(walk);
         }
       }
       else if (r->getIsOnGround()) {
@@ -75,7 +76,8 @@ ControlSystem::update(ECS::World* world, const sf::Time& dt) {
         // Set the animation of the sprite to idle
         auto s = e->get<Sprite>();
         if (s.isValid()) {
-          s->playAnimation("idle");
+          static const NameID idle = StringTable::intern("idle");
+          s->playAnimation(idle);
         }
       }
 
@@ -73,6 +73,7 @@ SOFTWARE.
 	\
 	ECS_DEFINE_TYPE(ECS::Events::OnEntityCreated);\
 	ECS_DEFINE_TYPE(ECS::Events::OnEntityDestroyed); \
+	ECS_DEFINE_TYPE(ECS::Events::OnSystemUpdated); \
 
 #endif
 
@@ -358,6 +359,14 @@ namespace ECS
 			Entity* entity;
 		};
 
+		// Called after a system has updated, so work it caused can be handled in batches.
+		struct OnSystemUpdated
+		{
+			ECS_DECLARE_TYPE;
+
+			EntitySystem* system;
+		};
+
 		// Called when a component is assigned (not necessarily created).
 		template<typename T>
 		struct OnComponentAssigned
@@ -599,6 +608,14 @@ namespace ECS
 			return ent;
 		}
 
+		/**
+		* Reserve room for a number of new entities, so creating them in bulk doesn't reallocate.
+		*/
+		void reserve(size_t count)
+		{
+			entities.reserve(entities.size() + count);
+		}
+
 		/**
 		* Destroy an entity. This will emit the OnEntityDestroy event.
 		*
@@ -802,6 +819,7 @@ namespace ECS
 #else
 				system->update(this, data);
 #endif
+				emit<Events::OnSystemUpdated>({ system });
 			}
 		}
 
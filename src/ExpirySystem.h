@@ -8,6 +8,7 @@
 #include "Scripting.h"
 
 #include "Expire.h"
+#include "ScriptEvents.h"
 
 // Update every expiry component every frame
 class ExpirySystem : public ECS::EntitySystem {
@@ -32,7 +33,10 @@ class ExpirySystem : public ECS::EntitySystem {
     virtual void update(ECS::World* world, const sf::Time& dt) override {
       world->each<Expire>([&](ECS::Entity* e, ECS::ComponentHandle<Expire> x) {
         const bool remove = x->update(dt);
-        if (remove) world->destroy(e);
+        if (remove) {
+          world->emit<ExpireEvent>({e});
+          world->destroy(e);
+        }
       });
     }
 };
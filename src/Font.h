@@ -6,16 +6,17 @@
 
 #include "Game.h"
 #include "Scripting.h"
+#include "AssetPack.h"
 
 // Resource for text
 class Font {
   public:
 
     // Allow the Font type to be made in Lua
-    static void registerFontType() {
+    static void registerFontType(sol::state_view lua) {
 
       // Register Texture type
-      Game::lua.new_usertype<Font>("Font",
+      lua.new_usertype<Font>("Font",
         sol::constructors<Font(const std::string&)>()
       );
     }
@@ -26,6 +27,11 @@ class Font {
       loadFromFilepath();
     }
 
+    // Get the path of the font file
+    const std::string& getFilepath() const {
+      return filepath_;
+    }
+
     // Get a pointer to the texture
     sf::Font& getFont() {
       return font_;
@@ -34,14 +40,18 @@ class Font {
   private:
 
     // Filepath to font
-    const std::string filepath_;
+    std::string filepath_;
 
     // Font for this resource to store
     sf::Font font_;
 
-    // Load texture from filepath
+    // Load font from filepath, packed fonts are read straight from the mapped file
     void loadFromFilepath() {
-      if (!font_.loadFromFile(filepath_)) { 
+      const AssetPack::Entry* packed = AssetPack::find(filepath_);
+      const bool success = packed != nullptr
+        ? font_.loadFromMemory(packed->data, packed->size)
+        : font_.loadFromFile(filepath_);
+      if (!success) { 
         Console::log("[Error] Could not load font from path: %s", filepath_.c_str());
       }
     }
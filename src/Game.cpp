@@ -5,16 +5,33 @@
 #include "Scene.h"
 #include "Config.h"
 #include "Scripting.h"
+#include "Replay.h"
+#include "ResourceLoader.h"
+#include "AssetPack.h"
+#include "ScriptCache.h"
+#include "ScriptProfiler.h"
+#include "ScriptCollector.h"
+#include "ScriptAllocator.h"
+#include "ScriptWatchdog.h"
 
 // Initialise static members
 sf::RenderWindow* Game::window_ = nullptr;
 sf::View Game::view = sf::View();
 bool Game::multiThread_ = false;
+bool Game::headless_ = false;
 std::mutex Game::windowMutex_;
 bool Game::debug_ = false;
 Game::Status Game::status_ = Game::Status::Uninitialised;
 Scene* Game::currentScene_ = nullptr;
+Scene* Game::nextScene_ = nullptr;
+
+// Small Lua objects come from pools, LuaJIT on 64-bit can't be given an allocator
+#if defined(SOL_LUAJIT) && SOL_LUAJIT
 sol::state Game::lua;
+#else
+sol::state Game::lua(sol::default_at_panic, &ScriptAllocator::allocate);
+#endif
+
 sf::Vector2f Game::mousePosition_ = sf::Vector2f();
 sf::Vector2f Game::displaySize_ = sf::Vector2f();
 Console Game::console_;
@@ -25,7 +42,7 @@ std::queue<ImWchar> Game::queuedChars_ = std::queue<ImWchar>();
 
 // Initialise the game without starting the loop
 void
-Game::initialise(const sf::VideoMode& mode, const std::string& title, bool multiThread) {
+Game::initialise(const sf::VideoMode& mode, const std::string& title, bool multiThread, bool headless) {
 
   // Enable console debugging
   Console::initialise(true);
@@ -43,7 +60,8 @@ Game::initialise(const sf::VideoMode& mode, const std::string& title, bool multi
     Build_VERSION_TWEAK);
 
   // Flag whether we are in multithreaded mode
-  multiThread_ = multiThread;
+  headless_ = headless;
+  multiThread_ = multiThread && !headless_;
 
   // Initialise Lua and ensure it works
   bool success = initialiseLua("GameConfig.lua");
@@ -58,19 +76,46 @@ Game::initialise(const sf::VideoMode& mode, const std::string& title, bool multi
   // Print if we are in multithreaded mode or not
   Console::log("Running in %s mode.", multiThread_ ? "multithreaded" : "standard");
 
+  // Without a window, pretend the display is the requested size
+  if (headless_) {
+    Console::log("Running headless.");
+    displaySize_ = sf::Vector2f(mode.width, mode.height);
+    view = sf::View(sf::FloatRect(0.f, 0.f, displaySize_.x, displaySize_.y));
+  }
+
   // Create window and prepare view
-  window_ = new sf::RenderWindow(mode, title);
-  view = window_->getDefaultView();
+  else {
+    window_ = new sf::RenderWindow(mode, title);
+    view = window_->getDefaultView();
 
-  // Set up size of the window
-  const auto size = window_->getSize();
-  displaySize_ = sf::Vector2f(size.x, size.y);
+    // Set up size of the window
+    const auto size = window_->getSize();
+    displaySize_ = sf::Vector2f(size.x, size.y);
+  }
 
-  // Load assets
+  // Load assets, from the asset pack when one has been built
+  // Loose files edited since the pack was built win, so changes aren't silently ignored
+  if (std::filesystem::exists("Assets.pak")) {
+    if (AssetPack::isOutOfDate("Assets.pak", "Assets/")) {
+      Console::log("[Warning] Assets.pak is older than files in Assets/, loading the loose files instead. "
+        "Rebuild the pack to use it again.");
+    }
+    else {
+      AssetPack::open("Assets.pak");
+    }
+  }
+  ResourceLoader::start();
   ResourceManager::loadResources("Assets/");
 
+  // Reload loose assets as they are edited, replays need them to stay the same
+  if (!headless_ && !AssetPack::isOpen()) {
+    ResourceManager::watchResources("Assets/");
+  }
+
   // Enable debugging functionality
-  ImGui::SFML::Init(*window_);
+  if (!headless_) {
+    ImGui::SFML::Init(*window_);
+  }
 
   // Flag that the game is ready to start
   status_ = Game::Status::Ready;
@@ -115,6 +160,7 @@ Game::start() {
 
     // Get the time since last tick
     sf::Time elapsed_ = clock_.restart();
+    ScriptWatchdog::startFrame();
 
     // Calculate FPS
     if (fpsClock_.getElapsedTime().asSeconds() >= 1.0f) {
@@ -128,6 +174,24 @@ Game::start() {
     bool process = true;
     std::vector<sf::Event> events;
 
+    // When headless, time and input come from the replay
+    if (headless_) {
+      process = false;
+      if (Replay::readFrame(elapsed_, events)) {
+        for (const auto& ev : events) {
+          handleEvent(ev);
+        }
+      }
+      else {
+
+        // Nothing else can drive a headless game, so finish the replay and shut down
+        Replay::stop();
+        terminate();
+        break;
+      }
+    }
+    Replay::beginFrame(elapsed_);
+
     // If multithreading, gain access to window quickly
     if (multiThread_) { process = windowMutex_.try_lock(); }
     sf::Event e;
@@ -161,6 +225,7 @@ Game::start() {
 
     // Update the game
     update(elapsed_);
+    Replay::endFrame();
 
     // Render every frame after updating
     if (!multiThread_) {
@@ -171,6 +236,10 @@ Game::start() {
     else {
       std::this_thread::yield();
     }
+
+    // Collect Lua garbage in whatever time is left this frame
+    ScriptCollector::step(clock_.getElapsedTime());
+    ScriptAllocator::endFrame();
   }
 
   // Wait for render thread to finish
@@ -240,9 +309,25 @@ Game::initialiseLua(const std::string& fp) {
   Console::addCommand("[Class] Console");
   Console::addCommand("Console.outputToTerminal");
 
+  // Allow scripts to be profiled from the console
+  ScriptProfiler::registerProfilerType();
+
+  // Collect Lua garbage between frames rather than on allocation
+  ScriptCollector::registerCollectorType();
+
+  // Stop scripts that run too long
+  ScriptWatchdog::registerWatchdogType();
+
   // Tries to call the global config script
   // If this fails, lua is not working and cannot read files
-	auto attempt = Game::lua.script_file(fp, &sol::script_pass_on_error);
+  sol::protected_function chunk;
+  std::string error;
+  if (!ScriptCache::load(Game::lua, fp, chunk, error)) {
+    Console::log("[Error] in %s:\n> %s", fp.c_str(), error.c_str());
+    return false;
+  }
+  ScriptWatchdog::Budget budget("GameConfig", ScriptWatchdog::getLoadingLimits());
+  auto attempt = chunk();
   if (!attempt.valid()) {
     sol::error err = attempt;
     Console::log("[Error] in %s:\n> %s", fp.c_str(), err.what());
@@ -261,19 +346,62 @@ void
 Game::update(const sf::Time& dt) {
 
   // Easy out
-  if (window_ == nullptr) return;
+  if (window_ == nullptr && !headless_) return;
 
   // Update mouse position every frame
-  sf::Vector2i mousePixelCoords = sf::Mouse::getPosition(*window_);
-  mousePosition_ = window_->mapPixelToCoords(mousePixelCoords);
+  sf::Vector2i mousePixelCoords;
+  if (headless_) {
+    mousePosition_ = Replay::getMousePosition();
+  }
+  else {
+    mousePixelCoords = sf::Mouse::getPosition(*window_);
+    mousePosition_ = window_->mapPixelToCoords(mousePixelCoords);
+  }
+  Replay::recordMousePosition(mousePosition_);
+
+  // Pick up edited resources, the render thread may be drawing the ones being replaced
+  ResourceManager::updateWatch();
+  if (ResourceManager::hasSettledChanges()) {
+    if (multiThread_) {
+      std::lock_guard<std::mutex> lock(windowMutex_);
+      ResourceManager::reloadChanges();
+    }
+    else {
+      ResourceManager::reloadChanges();
+    }
+  }
+
+  // Upload resources that finished loading in the background
+  if (ResourceLoader::hasCompleted()) {
+    if (multiThread_) {
+      std::lock_guard<std::mutex> lock(windowMutex_);
+      ResourceLoader::update();
+    }
+    else {
+      ResourceLoader::update();
+    }
+  }
+
+  // Finish switching scene once its resources have loaded
+  if (nextScene_ != nullptr) {
+    const float progress = nextScene_->getLoadingProgress();
+    nextScene_->reportLoadingProgress(progress);
+    if (progress >= 1.f) {
+      finishSwitchingScene();
+    }
+  }
+
+  // Release unused resources when over the memory budget
+  ResourceManager::enforceMemoryBudget();
 
   // Update the screen if the pointer is set
+  ScriptProfiler::countFrame();
   if (currentScene_ != nullptr) {
     currentScene_->update(dt);
   }
 
   // Update IMGUI debug interfaces
-  if (debug_ && !isImguiReady_) {
+  if (debug_ && !isImguiReady_ && !headless_) {
 
     // Pass queued characters to ImGui
     auto& io = ImGui::GetIO();
@@ -348,8 +476,8 @@ Game::handleEvent(const sf::Event& event) {
 
   // Pass events to IMGUI debug interface
   bool passToGame = true;
-  bool passToImgui = debug_;
-  if (debug_) {
+  bool passToImgui = debug_ && !headless_;
+  if (passToImgui) {
 
     // Get reference to IO
     auto& io = ImGui::GetIO();
@@ -373,6 +501,7 @@ Game::handleEvent(const sf::Event& event) {
 
   // Pass events to scene
   if (currentScene_ != nullptr && passToGame) {
+    Replay::recordEvent(event);
     currentScene_->handleEvent(event);
   }
 }
@@ -409,14 +538,20 @@ Game::terminate() {
   }
 
   // Shut down IMGUI debug interface
-  ImGui::SFML::Shutdown();
+  if (!headless_) {
+    ImGui::SFML::Shutdown();
+  }
 }
 
 // Free resources before program closes
 void
 Game::shutdown() {
   status_ = Game::Status::Uninitialised;
+  Replay::stop();
+  ResourceManager::stopWatching();
+  ResourceLoader::stop();
   ResourceManager::releaseResources();
+  AssetPack::close();
 
   // Shut down console debugging
   Console::shutdown();
@@ -435,17 +570,51 @@ Game::getWorld() {
   return nullptr;
 }
 
-// Change to the new screen
+// Change to the new screen once its resources are loaded
 void 
 Game::switchScene(Scene* scene) {
 
+  // Cancel any switch that is still loading
+  if (nextScene_ != nullptr && nextScene_ != scene) {
+    nextScene_->releasePrefetched();
+  }
+
+  // Start loading what the scene used last time, or declared it uses
+  nextScene_ = scene;
+  if (scene != nullptr) {
+    scene->prefetch();
+  }
+
+  // Keep the current scene running while the next one loads
+  // Replays must switch on the same frame every time, so they wait instead
+  const bool isDeterministic = Replay::getMode() != Replay::Mode::Off;
+  if (scene == nullptr || !scene->hasDependencies() || isDeterministic) {
+    if (scene != nullptr) {
+      scene->waitForResources();
+      scene->reportLoadingProgress(1.f);
+    }
+    finishSwitchingScene();
+  }
+}
+
+// Switch to the next scene now that its resources are loaded
+void
+Game::finishSwitchingScene() {
+
   // Switch away from old screen
   if (currentScene_ != nullptr) {
     currentScene_->hideScene();
   }
 
   // Change the screen to be rendered
-  currentScene_ = scene;
+  if (multiThread_) {
+    std::lock_guard<std::mutex> lock(windowMutex_);
+    currentScene_ = nextScene_;
+  }
+  else {
+    currentScene_ = nextScene_;
+  }
+  nextScene_ = nullptr;
 
   // Run any logic for showing screen
   if (currentScene_ != nullptr) {
@@ -470,6 +639,7 @@ Game::handleImgui() {
     if (ImGui::BeginMenu("View")) {
       ImGui::MenuItem("Demo imgui", NULL, &showImguiDemo);
       ImGui::MenuItem("Console", NULL, &showConsole_);
+      ScriptProfiler::addDebugMenuEntry();
 
       // Allow the scene to make entries to the view tab
       if (currentScene_ != nullptr) {
@@ -486,6 +656,9 @@ Game::handleImgui() {
   // Show console
   if (showConsole_) { console_.create("Console", &showConsole_); }
 
+  // Show script profiler
+  ScriptProfiler::showDebugWindow();
+
   // Info
   ImGui::Spacing();
   ImGui::Text(std::string(
@@ -509,6 +682,16 @@ Game::handleImgui() {
     std::to_string((int)mousePosition_.y) + ")").c_str());
   ImGui::Spacing();
 
+  // Resources
+  ResourceManager::showDebugInformation();
+  ImGui::Spacing();
+
+  // Lua garbage
+  ScriptCollector::showDebugInformation();
+  ScriptAllocator::showDebugInformation();
+  ScriptWatchdog::showDebugInformation();
+  ImGui::Spacing();
+
   // End default debug window
   ImGui::End();
 
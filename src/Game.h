@@ -33,12 +33,14 @@ class Game {
     static sf::View view;
 
     // Initialise the game window
-    static void initialise(const sf::VideoMode& m, const std::string& title, bool multiThread = false);
+    // Headless games have no window and take their input from a replay
+    static void initialise(const sf::VideoMode& m, const std::string& title, bool multiThread = false, bool headless = false);
 
     // Start the game, calling update and render loops
     static void start();
 
     // Change the screen that is used and rendered
+    // The switch completes once the scene's known resources have loaded
     static void switchScene(Scene* scene);
 
     // Get a pointer to const window
@@ -84,6 +86,9 @@ class Game {
     // Whether we are multithreaded
     static bool multiThread_;
 
+    // Whether we are running without a window
+    static bool headless_;
+
     // Enable debugging functionality
     static bool debug_;
 
@@ -96,6 +101,9 @@ class Game {
     // Scene management
     static Scene* currentScene_;
 
+    // Scene waiting for its resources before being switched to
+    static Scene* nextScene_;
+
     // Up to date mouse position
     static sf::Vector2f mousePosition_;
 
@@ -132,6 +140,9 @@ class Game {
 
     // Handle the updating of IMGUI interfaces
     static void handleImgui();
+
+    // Switch to the next scene now that its resources are loaded
+    static void finishSwitchingScene();
 };
 
 #endif
@@ -3,6 +3,9 @@
 
 #include "PhysicsSystem.h"
 
+// Avoid cyclic dependencies
+#include "Replay.h"
+
 // Define statics
 const float PhysicsSystem::scale = 100.f;
 bool PhysicsSystem::showPhysicsWindow_ = false;
@@ -24,6 +27,7 @@ PhysicsSystem::registerPhysicsSystem(sol::environment& env, ECS::World* world) {
 
     // Get the new physics world
     b2World* physicsWorld = newPS->getWorld();
+    BodyPool* bodyPool = newPS->getBodyPool();
 
     // Allow the system's manipulation through lua
     env.set("Physics", newPS);
@@ -34,6 +38,55 @@ PhysicsSystem::registerPhysicsSystem(sol::environment& env, ECS::World* world) {
       "setGravityMult", &PhysicsSystem::setGravityMult,
       "bodyCount", sol::property(
         [](const PhysicsSystem& self) { return self.world_.GetBodyCount(); }),
+      "pooledBodyCount", sol::property(
+        [](const PhysicsSystem& self) { return self.bodyPool_.getPooledCount(); }),
+      "clearBodyPool", [](PhysicsSystem& self) { self.bodyPool_.clear(); },
+      "addStaticBox", [](PhysicsSystem& self, float x, float y, float w, float h) {
+        self.staticGeometry_.addBox(x, y, w, h); },
+      "addStaticEdge", [](PhysicsSystem& self, float x1, float y1, float x2, float y2) {
+        self.staticGeometry_.addEdge(x1, y1, x2, y2); },
+      "setStaticFixture", [](PhysicsSystem& self, const b2FixtureDef& def) {
+        self.staticGeometry_.setFixtureDef(def); },
+      "clearStaticGeometry", [](PhysicsSystem& self) { self.staticGeometry_.clear(); },
+      "staticCellSize", sol::property(
+        [](const PhysicsSystem& self) { return self.staticGeometry_.getCellSize(); },
+        [](PhysicsSystem& self, float size) { self.staticGeometry_.setCellSize(size); }),
+      "stepRate", sol::property(
+        [](const PhysicsSystem& self) { return self.defaultQuality_.stepRate; },
+        [](PhysicsSystem& self, float rate) {
+          auto q = self.defaultQuality_; q.stepRate = rate; self.changeQuality(self.defaultQuality_, q); }),
+      "velocityIterations", sol::property(
+        [](const PhysicsSystem& self) { return self.defaultQuality_.velocityIterations; },
+        [](PhysicsSystem& self, int iterations) {
+          auto q = self.defaultQuality_; q.velocityIterations = iterations; self.changeQuality(self.defaultQuality_, q); }),
+      "positionIterations", sol::property(
+        [](const PhysicsSystem& self) { return self.defaultQuality_.positionIterations; },
+        [](PhysicsSystem& self, int iterations) {
+          auto q = self.defaultQuality_; q.positionIterations = iterations; self.changeQuality(self.defaultQuality_, q); }),
+      "minStepRate", sol::property(
+        [](const PhysicsSystem& self) { return self.minimumQuality_.stepRate; },
+        [](PhysicsSystem& self, float rate) {
+          auto q = self.minimumQuality_; q.stepRate = rate; self.changeQuality(self.minimumQuality_, q); }),
+      "minVelocityIterations", sol::property(
+        [](const PhysicsSystem& self) { return self.minimumQuality_.velocityIterations; },
+        [](PhysicsSystem& self, int iterations) {
+          auto q = self.minimumQuality_; q.velocityIterations = iterations; self.changeQuality(self.minimumQuality_, q); }),
+      "minPositionIterations", sol::property(
+        [](const PhysicsSystem& self) { return self.minimumQuality_.positionIterations; },
+        [](PhysicsSystem& self, int iterations) {
+          auto q = self.minimumQuality_; q.positionIterations = iterations; self.changeQuality(self.minimumQuality_, q); }),
+      "maxSteps", sol::property(
+        &PhysicsSystem::getMaxSteps,
+        &PhysicsSystem::setMaxSteps),
+      "qualityLevel", sol::property(
+        &PhysicsSystem::getQualityLevel,
+        &PhysicsSystem::setQualityLevel),
+      "adaptiveQuality", sol::property(
+        [](const PhysicsSystem& self) { return self.adaptiveQuality_; },
+        [](PhysicsSystem& self, bool enable) { self.adaptiveQuality_ = enable; }),
+      "qualityBudget", sol::property(
+        [](const PhysicsSystem& self) { return self.qualityBudget_; },
+        [](PhysicsSystem& self, float budget) { self.qualityBudget_ = std::max(0.01f, budget); }),
       "showHitboxes", sol::property(
         [](const PhysicsSystem& self) { return self.showRigidBodies_; },
         [](bool enable) { PhysicsSystem::showRigidBodies_ = enable; })
@@ -44,10 +97,27 @@ PhysicsSystem::registerPhysicsSystem(sol::environment& env, ECS::World* world) {
     Console::addCommand("Physics.gravity");
     Console::addCommand("Physics:setGravityMult");
     Console::addCommand("Physics.bodyCount");
+    Console::addCommand("Physics.pooledBodyCount");
+    Console::addCommand("Physics:clearBodyPool");
+    Console::addCommand("Physics:addStaticBox");
+    Console::addCommand("Physics:addStaticEdge");
+    Console::addCommand("Physics:setStaticFixture");
+    Console::addCommand("Physics:clearStaticGeometry");
+    Console::addCommand("Physics.staticCellSize");
+    Console::addCommand("Physics.stepRate");
+    Console::addCommand("Physics.velocityIterations");
+    Console::addCommand("Physics.positionIterations");
+    Console::addCommand("Physics.minStepRate");
+    Console::addCommand("Physics.minVelocityIterations");
+    Console::addCommand("Physics.minPositionIterations");
+    Console::addCommand("Physics.maxSteps");
+    Console::addCommand("Physics.qualityLevel");
+    Console::addCommand("Physics.adaptiveQuality");
+    Console::addCommand("Physics.qualityBudget");
     Console::addCommand("Physics.showHitboxes");
 
     // Allow the use of RigidBodies
-    RigidBody::registerRigidBodyType(env, physicsWorld);
+    RigidBody::registerRigidBodyType(env, physicsWorld, bodyPool);
   });
 }
 
@@ -55,6 +125,8 @@ PhysicsSystem::registerPhysicsSystem(sol::environment& env, ECS::World* world) {
 PhysicsSystem::PhysicsSystem() 
   : defaultGravity_(sf::Vector2f(0.f, 1000.f))
   , world_(convertToB2(defaultGravity_))
+  , bodyPool_(&world_)
+  , staticGeometry_(&world_)
   , timeStepAccumilator_(0.0f) {
 
   // Set up our contact listener
@@ -86,6 +158,11 @@ PhysicsSystem::update(ECS::World* world, const sf::Time& dt) {
   fixedTimeStepRatio_ = timeStepAccumilator_ / fixedTimeStep_;
   const int stepsClamped = std::min(steps, maxSteps_);
 
+  // Only profile while someone is looking
+  const bool profiling = showPhysicsWindow_;
+  sf::Clock profileClock;
+  frameProfile_ = b2Profile();
+
   // Give rigidbodies access to their entities
   // Also check if any b2Body's are out of sync
   world->each<Transform, RigidBody>([&](ECS::Entity* e, ECS::ComponentHandle<Transform> t, ECS::ComponentHandle<RigidBody> r) {
@@ -106,6 +183,12 @@ PhysicsSystem::update(ECS::World* world, const sf::Time& dt) {
     }
   });
 
+  // Destroy any old bodies and rebuild changed level geometry before simulating
+  bodyPool_.flush();
+  staticGeometry_.build();
+  const float syncTime = profileClock.restart().asSeconds() * 1000.f;
+  sf::Clock stepClock;
+
   // Simulate only when we should
   for (int i = 0; i < stepsClamped; ++i) {
 
@@ -116,21 +199,44 @@ PhysicsSystem::update(ECS::World* world, const sf::Time& dt) {
 
     // Simulate
     singleStep(fixedTimeStep_);
+
+    // Add this step's timings to the frame
+    if (profiling) {
+      const b2Profile& p = world_.GetProfile();
+      frameProfile_.step += p.step;
+      frameProfile_.collide += p.collide;
+      frameProfile_.solve += p.solve;
+      frameProfile_.solveTOI += p.solveTOI;
+      frameProfile_.broadphase += p.broadphase;
+    }
   }
 
   // Reset applied forces
   world_.ClearForces();
 
-  // Tween in between physics steps and destroy any old bodies
+  // Keep physics within its budget
+  updateQuality(dt, stepClock.getElapsedTime().asSeconds() * 1000.f, steps - stepsClamped);
+
+  // Tween in between physics steps
+  profileClock.restart();
   world->each<Transform, RigidBody>([&](ECS::Entity* e, ECS::ComponentHandle<Transform> t, ECS::ComponentHandle<RigidBody> r) {
     smoothState(t, r);
-
-    // Dispose of any old bodies and clear the disposal list
-    for (auto* d : r->disposeList_) {
-      world_.DestroyBody(d);
-    }
-    r->disposeList_.clear();
   });
+
+  // Record how this frame went
+  if (profiling) {
+    profile_.interpolate.push(profileClock.getElapsedTime().asSeconds() * 1000.f);
+    profile_.sync.push(syncTime);
+    profile_.step.push(frameProfile_.step);
+    profile_.collide.push(frameProfile_.collide);
+    profile_.solve.push(frameProfile_.solve);
+    profile_.solveTOI.push(frameProfile_.solveTOI);
+    profile_.broadphase.push(frameProfile_.broadphase);
+    profile_.contacts.push(world_.GetContactCount());
+    profile_.awakeBodies.push(getAwakeBodyCount());
+    profile_.stepsExecuted.push(stepsClamped);
+    profile_.stepsDropped.push(steps - stepsClamped);
+  }
 }
 
 // Single-step the physics
@@ -185,12 +291,146 @@ PhysicsSystem::resetSmoothStates(ECS::ComponentHandle<RigidBody> r) {
   }
 }
 
+// Apply the settings for the current quality level
+void
+PhysicsSystem::applyQuality() {
+
+  // Blend between full and lowest quality
+  const float t = static_cast<float>(qualityLevel_) / qualityLevels_;
+  auto blend = [t](float full, float lowest) { return full + (lowest - full) * t; };
+  fixedTimeStep_ = 1.f / blend(defaultQuality_.stepRate, minimumQuality_.stepRate);
+  velocityIterations_ = std::lround(blend(
+    defaultQuality_.velocityIterations, minimumQuality_.velocityIterations));
+  positionIterations_ = std::lround(blend(
+    defaultQuality_.positionIterations, minimumQuality_.positionIterations));
+}
+
+// Change full or lowest quality settings, keeping the current quality level
+bool
+PhysicsSystem::changeQuality(PhysicsQuality& target, const PhysicsQuality& quality) {
+  if (quality.stepRate <= 0.f || quality.velocityIterations < 1 || quality.positionIterations < 1) {
+    Console::log("[Error] Physics step rate and iterations must be above 0.");
+    return false;
+  }
+  target = quality;
+  applyQuality();
+  return true;
+}
+
+// Raise or lower quality depending on how long stepping took
+void
+PhysicsSystem::updateQuality(const sf::Time& dt, float stepTime, int droppedSteps) {
+
+  // Easy out
+  // Step times differ between machines, so quality stays put while recording or replaying
+  const float frameTime = dt.asSeconds() * 1000.f;
+  if (!adaptiveQuality_ || frameTime <= 0.f) { return; }
+  if (Replay::getMode() != Replay::Mode::Off) { return; }
+
+  // Track how much of the frame physics is taking
+  physicsLoad_ = physicsLoad_ * 0.9f + std::min(1.f, stepTime / frameTime) * 0.1f;
+  droppedFrames_ = droppedSteps > 0 ? droppedFrames_ + 1 : 0;
+
+  // Give the last change time to take effect
+  qualityCooldown_ -= dt.asSeconds();
+  if (qualityCooldown_ > 0.f) { return; }
+
+  // Lower quality when over budget or when steps keep being dropped
+  const bool overBudget = physicsLoad_ > qualityBudget_ || droppedFrames_ >= 3;
+  if (overBudget && qualityLevel_ < qualityLevels_) {
+    ++qualityLevel_;
+    applyQuality();
+    qualityCooldown_ = 1.f;
+    Console::log("[Warning] Physics is over budget (%.0f%% of frame, %d dropped steps), "
+      "lowering quality to %.0fHz with %d/%d iterations.",
+      physicsLoad_ * 100.f, droppedSteps, 1.f / fixedTimeStep_,
+      velocityIterations_, positionIterations_);
+  }
+
+  // Raise quality again once there's plenty of room
+  else if (!overBudget && physicsLoad_ < qualityBudget_ * 0.5f && qualityLevel_ > 0) {
+    --qualityLevel_;
+    applyQuality();
+    qualityCooldown_ = 3.f;
+    Console::log("[Note] Physics has headroom, raising quality to %.0fHz with %d/%d iterations.",
+      1.f / fixedTimeStep_, velocityIterations_, positionIterations_);
+  }
+}
+
+// Change the settings used at full quality and returns to full quality
+void
+PhysicsSystem::setDefaultQuality(const PhysicsQuality& quality) {
+  if (changeQuality(defaultQuality_, quality)) {
+    setQualityLevel(0);
+  }
+}
+
+// Get the settings used at full quality
+const PhysicsQuality&
+PhysicsSystem::getDefaultQuality() const {
+  return defaultQuality_;
+}
+
+// Change the lowest settings the quality controller may use
+void
+PhysicsSystem::setMinimumQuality(const PhysicsQuality& quality) {
+  changeQuality(minimumQuality_, quality);
+}
+
+// Get the lowest settings the quality controller may use
+const PhysicsQuality&
+PhysicsSystem::getMinimumQuality() const {
+  return minimumQuality_;
+}
+
+// Force a quality level, 0 is full quality
+void
+PhysicsSystem::setQualityLevel(int level) {
+  qualityLevel_ = std::max(0, std::min(level, qualityLevels_));
+  qualityCooldown_ = 1.f;
+  applyQuality();
+}
+
+// Get the current quality level
+int
+PhysicsSystem::getQualityLevel() const {
+  return qualityLevel_;
+}
+
+// Change how many steps can be taken in a single frame
+void
+PhysicsSystem::setMaxSteps(int steps) {
+  maxSteps_ = std::max(1, steps);
+}
+
+// Get how many steps can be taken in a single frame
+int
+PhysicsSystem::getMaxSteps() const {
+  return maxSteps_;
+}
+
+// Count the bodies that are currently awake
+int
+PhysicsSystem::getAwakeBodyCount() const {
+  int count = 0;
+  for (const b2Body* b = world_.GetBodyList(); b != nullptr; b = b->GetNext()) {
+    if (b->IsAwake() && b->GetType() != b2_staticBody) { ++count; }
+  }
+  return count;
+}
+
 // Get this system's physics world
 b2World*
 PhysicsSystem::getWorld() {
   return &world_;
 }
 
+// Get the pool of reusable bodies
+BodyPool*
+PhysicsSystem::getBodyPool() {
+  return &bodyPool_;
+}
+
 // Get gravity
 sf::Vector2f
 PhysicsSystem::getGravity() const {
@@ -250,6 +490,11 @@ PhysicsSystem::receive(ECS::World* w, const addDebugInfoEvent& e) {
   // Add to default window
   ImGui::Begin("Debug");
   ImGui::Text("Physics bodies: %d", world_.GetBodyCount());
+  ImGui::Text("Pooled bodies: %lu (reused %u)", 
+    bodyPool_.getPooledCount(), bodyPool_.getReuseCount());
+  ImGui::Text("Static geometry: %lu pieces in %lu chunks, %lu fixtures",
+    staticGeometry_.getSourceCount(), staticGeometry_.getChunkCount(),
+    staticGeometry_.getFixtureCount());
   ImGui::End();
 
   // Make a physics window
@@ -258,9 +503,59 @@ PhysicsSystem::receive(ECS::World* w, const addDebugInfoEvent& e) {
     float gravity = gravityVec.y / 10.f;
     ImGui::Begin("Physics System", &showPhysicsWindow_);
     ImGui::DragFloat("Gravity", &gravity, 2.f);
+
+    // Quality controls
+    if (ImGui::CollapsingHeader("Quality", ImGuiTreeNodeFlags_DefaultOpen)) {
+      int level = qualityLevel_;
+      ImGui::Checkbox("Adaptive", &adaptiveQuality_);
+      if (ImGui::SliderInt("Level", &level, 0, qualityLevels_)) {
+        setQualityLevel(level);
+      }
+      ImGui::SliderFloat("Budget", &qualityBudget_, 0.05f, 1.f, "%.2f of frame");
+      ImGui::Text("%.0fHz, %d velocity / %d position iterations, %d max steps",
+        1.f / fixedTimeStep_, velocityIterations_, positionIterations_, maxSteps_);
+      ImGui::Text("Load: %.0f%% of frame", physicsLoad_ * 100.f);
+    }
+    showProfile();
     ImGui::End();
     if (gravity * 10.f != gravityVec.y) {
       setGravity(gravityVec.x, gravity * 10.f);
     }
   }
 }
+
+// Show the profiling graphs
+void
+PhysicsSystem::showProfile() {
+
+  // Time spent inside Box2D, summed over all steps in a frame
+  if (ImGui::CollapsingHeader("Box2D timings (ms)", ImGuiTreeNodeFlags_DefaultOpen)) {
+    profile_.step.plotLines("Step");
+    profile_.collide.plotLines("Collide");
+    profile_.solve.plotLines("Solve");
+    profile_.solveTOI.plotLines("Solve TOI");
+    profile_.broadphase.plotLines("Broadphase");
+  }
+
+  // Time spent in our own code
+  if (ImGui::CollapsingHeader("Engine timings (ms)", ImGuiTreeNodeFlags_DefaultOpen)) {
+    profile_.sync.plotLines("Sync");
+    profile_.interpolate.plotLines("Interpolate");
+  }
+
+  // Steps per frame, dropped steps mean the simulation can't keep up
+  if (ImGui::CollapsingHeader("Steps", ImGuiTreeNodeFlags_DefaultOpen)) {
+    profile_.stepsExecuted.plotHistogram("Executed");
+    profile_.stepsDropped.plotHistogram("Dropped");
+    if (profile_.stepsDropped.latest() > 0.f) {
+      ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f),
+        "Physics is falling behind, steps are clamped to %d per frame", maxSteps_);
+    }
+  }
+
+  // Amount of work in the world
+  if (ImGui::CollapsingHeader("World", ImGuiTreeNodeFlags_DefaultOpen)) {
+    profile_.contacts.plotHistogram("Contacts");
+    profile_.awakeBodies.plotHistogram("Awake bodies");
+  }
+}
@@ -12,9 +12,18 @@
 #include "Game.h"
 #include "Transform.h"
 #include "RigidBody.h"
+#include "BodyPool.h"
+#include "StaticGeometry.h"
 
 #include "PhysicsDebugDraw.h"
 
+// Settings that trade physics accuracy for speed
+struct PhysicsQuality {
+  float stepRate;
+  int velocityIterations;
+  int positionIterations;
+};
+
 class PhysicsSystem 
 : public ECS::EntitySystem
 , public ECS::EventSubscriber<DebugRenderPhysicsEvent>
@@ -53,12 +62,31 @@ class PhysicsSystem
     // Get this physics system's world
     b2World* getWorld();
 
+    // Get the pool of reusable bodies
+    BodyPool* getBodyPool();
+
     // Change the gravity
     void setGravityMult(float multiplier);
     sf::Vector2f getGravity() const;
     void setGravity(float gx, float gy);
     void setGravityVec(const sf::Vector2f& g);
 
+    // Change the settings used at full quality and returns to full quality
+    void setDefaultQuality(const PhysicsQuality& quality);
+    const PhysicsQuality& getDefaultQuality() const;
+
+    // Change the lowest settings the quality controller may use
+    void setMinimumQuality(const PhysicsQuality& quality);
+    const PhysicsQuality& getMinimumQuality() const;
+
+    // Force a quality level, 0 is full quality
+    void setQualityLevel(int level);
+    int getQualityLevel() const;
+
+    // Change how many steps can be taken in a single frame
+    void setMaxSteps(int steps);
+    int getMaxSteps() const;
+
   private:
 
     // ContactListener
@@ -70,16 +98,22 @@ class PhysicsSystem
     // The box2D world for physics simulation
     b2World world_;
 
+    // Reusable bodies and bodies waiting to be destroyed
+    BodyPool bodyPool_;
+
+    // Merged level geometry without entities
+    StaticGeometry staticGeometry_;
+
     // Debug rendering system
     PhysicsDebugDraw physicsDebugDraw_;
 
     // Maximum steps to queue before forcing action
     // A large amount of steps will create more strain,
     // reducing the framerate and creating more steps
-    const int maxSteps_ = 5;
+    int maxSteps_ = 5;
 
     // How long to wait per step
-    const float fixedTimeStep_ = 1.0f / 60.0f;
+    float fixedTimeStep_ = 1.0f / 60.0f;
 
     // A more accurate 'step' for interpolation
     float fixedTimeStepRatio_;
@@ -90,10 +124,54 @@ class PhysicsSystem
     int32 velocityIterations_ = 8;
     int32 positionIterations_ = 3;
 
+    // Settings at full and lowest quality
+    PhysicsQuality defaultQuality_ = { 60.f, 8, 3 };
+    PhysicsQuality minimumQuality_ = { 30.f, 3, 1 };
+
+    // How many levels there are between full and lowest quality
+    static const int qualityLevels_ = 4;
+
+    // Current quality level, 0 is full quality
+    int qualityLevel_ = 0;
+
+    // Whether quality is adjusted to fit the budget
+    bool adaptiveQuality_ = true;
+
+    // Fraction of each frame physics may take before lowering quality
+    float qualityBudget_ = 0.3f;
+
+    // Smoothed fraction of each frame spent stepping
+    float physicsLoad_ = 0.f;
+
+    // How many frames in a row have dropped steps
+    int droppedFrames_ = 0;
+
+    // Time to wait before changing quality again
+    float qualityCooldown_ = 0.f;
+
     // Imgui flags
     static bool showPhysicsWindow_;
     static bool showRigidBodies_;
 
+    // Rolling timings and counts for the physics window
+    struct Profile {
+      RollingHistory step;
+      RollingHistory collide;
+      RollingHistory solve;
+      RollingHistory solveTOI;
+      RollingHistory broadphase;
+      RollingHistory sync;
+      RollingHistory interpolate;
+      RollingHistory contacts;
+      RollingHistory awakeBodies;
+      RollingHistory stepsExecuted;
+      RollingHistory stepsDropped;
+    };
+    Profile profile_;
+
+    // Box2D timings summed over every step this frame
+    b2Profile frameProfile_;
+
     // Step through physics once
     void singleStep(float timeStep);
 
@@ -103,6 +181,21 @@ class PhysicsSystem
     // Reset interpolation to the actual physics locations
     void resetSmoothStates(ECS::ComponentHandle<RigidBody> r);
 
+    // Apply the settings for the current quality level
+    void applyQuality();
+
+    // Change full or lowest quality settings, keeping the current quality level
+    bool changeQuality(PhysicsQuality& target, const PhysicsQuality& quality);
+
+    // Raise or lower quality depending on how long stepping took
+    void updateQuality(const sf::Time& dt, float stepTime, int droppedSteps);
+
+    // Count the bodies that are currently awake
+    int getAwakeBodyCount() const;
+
+    // Show the profiling graphs
+    void showProfile();
+
     // Render the physics when debug mode is enabled
     virtual void receive(ECS::World* ecsWorld, const DebugRenderPhysicsEvent& ev) override;
 
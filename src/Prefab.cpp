@@ -0,0 +1,282 @@
+// Prefab.cpp
+// Entity templates described once in Lua and spawned in bulk from C++
+
+#include "Prefab.h"
+
+// Avoid cyclic dependencies
+#include "ResourceManager.h"
+#include "PhysicsSystem.h"
+#include "Spell.h"
+
+#include "Transform.h"
+#include "Sprite.h"
+#include "RigidBody.h"
+#include "Stats.h"
+#include "Abilities.h"
+
+// Allow prefabs to be made from tables in Lua
+void
+Prefab::registerPrefabType() {
+
+  // Create the Prefab type
+  Game::lua.new_usertype<Prefab>("Prefab",
+    sol::constructors<Prefab(const sol::table&)>(),
+    "componentCount", sol::property(&Prefab::getComponentCount)
+  );
+
+  // Add to auto complete
+  Console::addCommand("Prefab.new");
+}
+
+// Let a scene spawn prefabs into its world
+void
+Prefab::registerSpawnFunction(sol::environment& env, ECS::World* world) {
+
+  // Spawn a number of entities at once, returning them in a table
+  // Positions are either a start and a spacing between each entity, or a table of positions to cycle through
+  env.set_function("spawn", [world](const sol::table& self, const Prefab& prefab, unsigned count,
+    const sol::object& where, sol::optional<sf::Vector2f> spacing) {
+
+    // Bodies need the physics system of this world
+    if (prefab.hasBody_ && !self["RigidBody"].valid()) {
+      Console::log("[Error] Could not spawn prefab, it has a rigidBody but the physics system is not enabled.");
+      return sol::as_table(std::vector<ECS::Entity*>());
+    }
+    return sol::as_table(prefab.spawn(world, readPositions(count, where, spacing.value_or(sf::Vector2f()))));
+  });
+
+  // Add to auto complete
+  Console::addCommand("World:spawn");
+}
+
+// Compile a prefab out of its description
+Prefab::Prefab(const sol::table& description)
+  : rotation_(description.get_or("rotation", 0.f))
+  , hasSprite_(false)
+  , texture_(0)
+  , animations_(0)
+  , animation_(0)
+  , size_(sf::Vector2f(1.f, 1.f))
+  , scale_(sf::Vector2f(1.f, 1.f))
+  , origin_(sf::Vector2f(0.5f, 0.5f))
+  , hasStats_(false)
+  , hasBody_(false)
+  , hasGroundSensor_(false) {
+
+  // Sprite
+  sol::optional<sol::table> sprite = description["sprite"];
+  if (sprite) {
+    hasSprite_ = true;
+    const sol::table& s = sprite.value();
+    texture_ = StringTable::fromLua(s["texture"]);
+    animations_ = StringTable::fromLua(s["animations"]);
+    animation_ = StringTable::fromLua(s["animation"]);
+    size_ = s.get_or("size", size_);
+    scale_ = s.get_or("scale", scale_);
+    origin_ = s.get_or("origin", origin_);
+
+    // Each entity takes one of the anchors at random
+    sol::optional<sol::table> anchors = s["anchors"];
+    if (anchors) {
+      for (std::size_t i = 1; i <= anchors.value().size(); ++i) {
+        anchors_.push_back(anchors.value().get_or(i, sf::Vector2i()));
+      }
+    }
+  }
+
+  // Stats
+  sol::optional<sol::table> stats = description["stats"];
+  if (stats) {
+    hasStats_ = true;
+    sol::optional<sol::table> movement = stats.value()["movement"];
+    if (movement) {
+      const sol::table& m = movement.value();
+      movement_.movementSpeed = m.get_or("movementSpeed", movement_.movementSpeed);
+      movement_.sprintSpeedMult = m.get_or("sprintSpeedMult", movement_.sprintSpeedMult);
+      movement_.flightSpeed = m.get_or("flightSpeed", movement_.flightSpeed);
+      movement_.canSprint = m.get_or("canSprint", movement_.canSprint);
+      movement_.canJump = m.get_or("canJump", movement_.canJump);
+      movement_.canFly = m.get_or("canFly", movement_.canFly);
+      movement_.canSprintWhileFlying = m.get_or("canSprintWhileFlying", movement_.canSprintWhileFlying);
+    }
+    sol::optional<sol::table> combat = stats.value()["combat"];
+    if (combat) {
+      const sol::table& c = combat.value();
+      combat_.maxHealth = c.get_or("maxHealth", combat_.maxHealth);
+      combat_.deathDelay = c.get_or("deathDelay", combat_.deathDelay);
+      combat_.deleteOnDeath = c.get_or("deleteOnDeath", combat_.deleteOnDeath);
+      combat_.deleteAfterAnimation = c.get_or("deleteAfterAnimation", combat_.deleteAfterAnimation);
+    }
+  }
+
+  // RigidBody, fixtures take the same units as FixtureDef does in Lua
+  sol::optional<sol::table> body = description["rigidBody"];
+  if (body) {
+    hasBody_ = true;
+    const sol::table& b = body.value();
+    bodyDef_.type = b.get_or("type", b2_dynamicBody);
+    bodyDef_.fixedRotation = b.get_or("isFixedRotation", false);
+    hasGroundSensor_ = b.get_or("groundSensor", false);
+    sol::optional<sol::table> fixtures = b["fixtures"];
+    if (fixtures) {
+      for (std::size_t i = 1; i <= fixtures.value().size(); ++i) {
+        sol::optional<sol::table> fixture = fixtures.value()[i];
+        if (!fixture) { continue; }
+        const sol::table& f = fixture.value();
+        Fixture compiled;
+        sol::optional<sf::Vector2f> box = f["box"];
+        sol::optional<float> circle = f["circle"];
+        if (box) {
+          compiled.polygon = RigidBody::BoxShape(box.value().x, box.value().y);
+          compiled.isCircle = false;
+        }
+        else if (circle) {
+          compiled.circle = RigidBody::CircleShape(0.f, 0.f, circle.value());
+          compiled.isCircle = true;
+        }
+        else {
+          Console::log("[Warning] Prefab fixture %lu has no box or circle, it was skipped.", i);
+          continue;
+        }
+        // Left out values keep Box2D's defaults, as they would with FixtureDef.new()
+        compiled.def.density = f.get_or("density", compiled.def.density * PhysicsSystem::scale) / PhysicsSystem::scale;
+        compiled.def.friction = f.get_or("friction", compiled.def.friction * PhysicsSystem::scale) / PhysicsSystem::scale;
+        compiled.def.restitution = f.get_or("restitution", compiled.def.restitution * PhysicsSystem::scale) / PhysicsSystem::scale;
+        compiled.def.isSensor = f.get_or("isSensor", false);
+        fixtures_.push_back(compiled);
+      }
+    }
+  }
+
+  // Abilities, a list of spell names where the first is in slot 0
+  sol::optional<sol::table> abilities = description["abilities"];
+  if (abilities) {
+    for (std::size_t i = 1; i <= abilities.value().size(); ++i) {
+      const NameID name = StringTable::fromLua(abilities.value()[i]);
+      if (name != 0) {
+        abilities_.push_back(std::make_pair(unsigned(i - 1), name));
+      }
+    }
+  }
+}
+
+// Spawn an entity at every position
+std::vector<ECS::Entity*>
+Prefab::spawn(ECS::World* world, const std::vector<sf::Vector2f>& positions) const {
+  std::vector<ECS::Entity*> entities;
+  entities.reserve(positions.size());
+  world->reserve(positions.size());
+
+  // Look everything up once for the whole batch
+  std::vector<b2FixtureDef> fixtures;
+  fixtures.reserve(fixtures_.size());
+  for (const auto& fixture : fixtures_) {
+    fixtures.push_back(fixture.def);
+    fixtures.back().shape = fixture.isCircle
+      ? static_cast<const b2Shape*>(&fixture.circle)
+      : static_cast<const b2Shape*>(&fixture.polygon);
+  }
+  std::vector<std::pair<unsigned, Spell*>> spells;
+  for (const auto& ability : abilities_) {
+    Spell* spell = ResourceManager::getHandle<Spell>(ability.second).get();
+    if (spell == nullptr) {
+      Console::log("[Error] Could not add spell: %s\nNonexistant or incorrect resource type.",
+        StringTable::getString(ability.second).c_str());
+      continue;
+    }
+    spells.push_back(std::make_pair(ability.first, spell));
+  }
+
+  // A body with a single fixture can be reused from the pool
+  const bool isPooled = fixtures.size() == 1 && !hasGroundSensor_;
+  b2BodyDef bodyDef = bodyDef_;
+
+  // Create every entity from the compiled description
+  for (const sf::Vector2f& position : positions) {
+    ECS::Entity* e = world->create();
+    e->assign<Transform>(e, position, rotation_);
+
+    // Stats
+    if (hasStats_) {
+      Stats* stats = e->assign<Stats>(e).get();
+      stats->moveStats = movement_;
+      stats->combatStats = combat_;
+    }
+
+    // Sprite
+    if (hasSprite_) {
+      Sprite* sprite = e->assign<Sprite>(e).get();
+      sprite->size_ = size_;
+      sprite->scale_ = scale_;
+      sprite->origin_ = origin_;
+      if (!anchors_.empty()) {
+        sprite->spriteSheetAnchor_ = anchors_[Script::Funcs::randomInt(0, anchors_.size() - 1)];
+      }
+      if (texture_ != 0) { sprite->setSpriteFromResources(texture_); }
+      if (animations_ != 0) { sprite->setAnimationsFromResources(animations_); }
+      if (animation_ != 0) { sprite->playAnimation(animation_, true); }
+    }
+
+    // RigidBody, created where the entity is
+    if (hasBody_) {
+      RigidBody* body = e->assign<RigidBody>(e).get();
+      bodyDef.position = PhysicsSystem::convertToB2(position);
+      if (isPooled) {
+        body->instantiatePooledBody(bodyDef, fixtures.front());
+      }
+      else {
+        body->instantiateBody(bodyDef);
+        for (const auto& fixture : fixtures) {
+          body->addFixture(fixture);
+        }
+        if (hasGroundSensor_) {
+          body->makeGroundSensor();
+        }
+      }
+    }
+
+    // Abilities
+    if (!spells.empty()) {
+      Abilities* abilities = e->assign<Abilities>(e).get();
+      for (const auto& spell : spells) {
+        abilities->addAbility(spell.first, spell.second);
+      }
+    }
+    entities.push_back(e);
+  }
+  return entities;
+}
+
+// Get the amount of components each spawned entity gets
+unsigned
+Prefab::getComponentCount() const {
+  return 1 + hasStats_ + hasSprite_ + hasBody_ + !abilities_.empty();
+}
+
+// Work out where to spawn, from a position and spacing or a table of positions
+std::vector<sf::Vector2f>
+Prefab::readPositions(unsigned count, const sol::object& where, const sf::Vector2f& spacing) {
+  std::vector<sf::Vector2f> positions;
+  positions.reserve(count);
+
+  // A table of positions is cycled through
+  if (where.get_type() == sol::type::table) {
+    const sol::table& table = where.as<sol::table>();
+    std::vector<sf::Vector2f> given;
+    given.reserve(table.size());
+    for (std::size_t i = 1; i <= table.size(); ++i) {
+      given.push_back(table.get_or(i, sf::Vector2f()));
+    }
+    for (unsigned i = 0; i < count && !given.empty(); ++i) {
+      positions.push_back(given[i % given.size()]);
+    }
+    return positions;
+  }
+
+  // Otherwise each entity is placed a spacing after the last
+  const sf::Vector2f start = where.is<sf::Vector2f>() ? where.as<sf::Vector2f>() : sf::Vector2f();
+  for (unsigned i = 0; i < count; ++i) {
+    positions.push_back(start + spacing * float(i));
+  }
+  return positions;
+}
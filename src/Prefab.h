@@ -0,0 +1,80 @@
+// Prefab.h
+// Entity templates described once in Lua and spawned in bulk from C++
+
+#ifndef PREFAB_H
+#define PREFAB_H
+
+#include <utility>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+#include "Game.h"
+#include "Scripting.h"
+
+#include "Movement.h"
+#include "Combat.h"
+
+// A compiled description of an entity, spawning reads no Lua
+class Prefab {
+  public:
+
+    // Allow prefabs to be made from tables in Lua
+    static void registerPrefabType();
+
+    // Let a scene spawn prefabs into its world
+    static void registerSpawnFunction(sol::environment& env, ECS::World* world);
+
+    // Compile a prefab out of a description such as:
+    // { rotation, sprite = {...}, stats = { movement = {...}, combat = {...} },
+    //   rigidBody = { type, isFixedRotation, fixtures = {{...}}, groundSensor }, abilities = {...} }
+    Prefab(const sol::table& description);
+
+    // Spawn an entity at every position
+    std::vector<ECS::Entity*> spawn(ECS::World* world, const std::vector<sf::Vector2f>& positions) const;
+
+    // Get the amount of components each spawned entity gets
+    unsigned getComponentCount() const;
+
+  private:
+
+    // A fixture and the shape it points to
+    struct Fixture {
+      b2FixtureDef def;
+      b2PolygonShape polygon;
+      b2CircleShape circle;
+      bool isCircle;
+    };
+
+    // Work out where to spawn, from a position and spacing or a table of positions
+    static std::vector<sf::Vector2f> readPositions(unsigned count, const sol::object& where, const sf::Vector2f& spacing);
+
+    // Transform
+    float rotation_;
+
+    // Sprite
+    bool hasSprite_;
+    NameID texture_;
+    NameID animations_;
+    NameID animation_;
+    sf::Vector2f size_;
+    sf::Vector2f scale_;
+    sf::Vector2f origin_;
+    std::vector<sf::Vector2i> anchors_;
+
+    // Stats
+    bool hasStats_;
+    MovementStats movement_;
+    CombatStats combat_;
+
+    // RigidBody
+    bool hasBody_;
+    b2BodyDef bodyDef_;
+    std::vector<Fixture> fixtures_;
+    bool hasGroundSensor_;
+
+    // Spells in each ability slot
+    std::vector<std::pair<unsigned, NameID>> abilities_;
+};
+
+#endif
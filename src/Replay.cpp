@@ -0,0 +1,298 @@
+// Replay.cpp
+// Records and replays frames so that runs can be reproduced exactly
+
+#include "Replay.h"
+
+#include <algorithm>
+
+// Avoid cyclic dependencies
+#include "Console.h"
+
+// Initialise static members
+Replay::Mode Replay::mode_ = Replay::Mode::Off;
+sf::VideoMode Replay::videoMode_;
+std::ofstream Replay::output_;
+Replay::Frame Replay::frame_;
+std::vector<Replay::Frame> Replay::frames_;
+std::size_t Replay::frameIndex_ = 0;
+std::size_t Replay::impulseIndex_ = 0;
+unsigned Replay::mismatches_ = 0;
+sf::Int64 Replay::simulatedTime_ = 0;
+sf::Clock Replay::clock_;
+
+// Identifies replay files
+static const char replayMagic[4] = { 'R', 'R', 'E', 'P' };
+static const sf::Uint32 replayVersion = 1;
+
+// Write plain data to a binary stream
+template <typename T> static void
+writeValue(std::ostream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Read plain data from a binary stream
+template <typename T> static bool
+readValue(std::istream& in, T& value) {
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+  return in.good();
+}
+
+// Begin writing frames to a file
+bool
+Replay::startRecording(const std::string& fp, const sf::VideoMode& mode) {
+
+  // Only do one thing at a time
+  if (mode_ != Mode::Off) {
+    Console::log("[Error] Cannot record to %s - replay system is busy.", fp.c_str());
+    return false;
+  }
+
+  // Open the file
+  output_.open(fp, std::ios::binary | std::ios::trunc);
+  if (!output_.is_open()) {
+    Console::log("[Error] Could not open %s for recording.", fp.c_str());
+    return false;
+  }
+
+  // Write the header
+  output_.write(replayMagic, sizeof(replayMagic));
+  writeValue<sf::Uint32>(output_, replayVersion);
+  writeValue<sf::Uint32>(output_, mode.width);
+  writeValue<sf::Uint32>(output_, mode.height);
+
+  // Prepare to record
+  videoMode_ = mode;
+  frame_ = Frame();
+  simulatedTime_ = 0;
+  clock_.restart();
+  mode_ = Mode::Recording;
+  Console::log("Recording frames to %s..", fp.c_str());
+  return true;
+}
+
+// Load a recording to drive the game with
+bool
+Replay::startReplaying(const std::string& fp) {
+
+  // Only do one thing at a time
+  if (mode_ != Mode::Off) {
+    Console::log("[Error] Cannot replay %s - replay system is busy.", fp.c_str());
+    return false;
+  }
+
+  // Open the file
+  std::ifstream input(fp, std::ios::binary);
+  if (!input.is_open()) {
+    Console::log("[Error] Could not open replay %s.", fp.c_str());
+    return false;
+  }
+
+  // Check the header
+  char magic[4];
+  sf::Uint32 version = 0, width = 0, height = 0;
+  input.read(magic, sizeof(magic));
+  if (!input.good() || !std::equal(magic, magic + 4, replayMagic) ||
+    !readValue(input, version) || version != replayVersion ||
+    !readValue(input, width) || !readValue(input, height)) {
+    Console::log("[Error] %s is not a valid replay.", fp.c_str());
+    return false;
+  }
+
+  // Load every frame up front so that disk access doesn't skew timings
+  frames_.clear();
+  Frame frame;
+  while (readValue(input, frame.dt)) {
+    sf::Uint16 count = 0;
+    readValue(input, frame.mousePosition);
+    readValue(input, count);
+    frame.inputs.resize(count);
+    for (auto& in : frame.inputs) {
+      readValue(input, in.type);
+      readValue(input, in.code);
+    }
+    readValue(input, count);
+    frame.impulses.resize(count);
+    for (auto& imp : frame.impulses) {
+      readValue(input, imp.impulse);
+      readValue(input, imp.point);
+    }
+    if (input.fail()) {
+      Console::log("[Warning] Replay %s is truncated after %lu frames.", fp.c_str(), frames_.size());
+      break;
+    }
+    frames_.push_back(frame);
+  }
+
+  // Prepare to replay
+  videoMode_ = sf::VideoMode(width, height);
+  frameIndex_ = 0;
+  impulseIndex_ = 0;
+  mismatches_ = 0;
+  simulatedTime_ = 0;
+  clock_.restart();
+  mode_ = Mode::Replaying;
+  Console::log("Replaying %lu frames from %s..", frames_.size(), fp.c_str());
+  return true;
+}
+
+// Close any open recording and report results
+void
+Replay::stop() {
+
+  // Report how the recording or replay went
+  const float simulated = simulatedTime_ / 1000000.f;
+  const float elapsed = clock_.getElapsedTime().asSeconds();
+  if (mode_ == Mode::Recording) {
+    output_.close();
+    Console::log("Recording finished: %.2fs recorded.", simulated);
+  }
+  else if (mode_ == Mode::Replaying) {
+    Console::log("Replay finished: %lu frames, %.2fs simulated in %.2fs (%.1fx realtime).",
+      frameIndex_, simulated, elapsed, elapsed > 0.f ? simulated / elapsed : 0.f);
+    if (mismatches_ > 0) {
+      Console::log("[Warning] Replay diverged: %u impulses did not match the recording.", mismatches_);
+    }
+    frames_.clear();
+  }
+
+  // Go back to normal
+  mode_ = Mode::Off;
+}
+
+// Get what the replay system is doing
+Replay::Mode
+Replay::getMode() {
+  return mode_;
+}
+
+// Get the video mode the recording was made with
+sf::VideoMode
+Replay::getVideoMode() {
+  return videoMode_;
+}
+
+// Start recording a frame
+void
+Replay::beginFrame(const sf::Time& dt) {
+  if (mode_ != Mode::Recording) { return; }
+  frame_.dt = dt.asMicroseconds();
+  frame_.inputs.clear();
+  frame_.impulses.clear();
+}
+
+// Get the next recorded frame
+bool
+Replay::readFrame(sf::Time& dt, std::vector<sf::Event>& events) {
+
+  // Easy outs
+  if (mode_ != Mode::Replaying) { return false; }
+  if (frameIndex_ >= frames_.size()) { return false; }
+
+  // Start the frame
+  frame_ = frames_[frameIndex_];
+  impulseIndex_ = 0;
+  dt = sf::microseconds(frame_.dt);
+
+  // Rebuild input events
+  for (const auto& in : frame_.inputs) {
+    sf::Event ev;
+    ev.type = static_cast<sf::Event::EventType>(in.type);
+    if (ev.type == sf::Event::KeyPressed || ev.type == sf::Event::KeyReleased) {
+      ev.key.code = static_cast<sf::Keyboard::Key>(in.code);
+      ev.key.alt = ev.key.control = ev.key.shift = ev.key.system = false;
+    }
+    else {
+      ev.mouseButton.button = static_cast<sf::Mouse::Button>(in.code);
+      ev.mouseButton.x = frame_.mousePosition.x;
+      ev.mouseButton.y = frame_.mousePosition.y;
+    }
+    events.push_back(ev);
+  }
+  return true;
+}
+
+// Record an input event that reached the scene
+void
+Replay::recordEvent(const sf::Event& ev) {
+  if (mode_ != Mode::Recording) { return; }
+  if (ev.type == sf::Event::KeyPressed || ev.type == sf::Event::KeyReleased) {
+    frame_.inputs.push_back({ static_cast<sf::Uint8>(ev.type), ev.key.code });
+  }
+  else if (ev.type == sf::Event::MouseButtonPressed || ev.type == sf::Event::MouseButtonReleased) {
+    frame_.inputs.push_back({ static_cast<sf::Uint8>(ev.type), ev.mouseButton.button });
+  }
+}
+
+// Record where the mouse is this frame
+void
+Replay::recordMousePosition(const sf::Vector2f& pos) {
+  if (mode_ == Mode::Recording) {
+    frame_.mousePosition = pos;
+  }
+}
+
+// Get where the mouse was when recording this frame
+sf::Vector2f
+Replay::getMousePosition() {
+  return frame_.mousePosition;
+}
+
+// Record an impulse, or check it against the recording
+void
+Replay::logImpulse(const sf::Vector2f& impulse, const sf::Vector2f& point) {
+
+  // Record the impulse
+  if (mode_ == Mode::Recording) {
+    frame_.impulses.push_back({ impulse, point });
+  }
+
+  // Make sure the same impulse happened in the recording
+  else if (mode_ == Mode::Replaying) {
+    const bool matches = impulseIndex_ < frame_.impulses.size() &&
+      frame_.impulses[impulseIndex_].impulse == impulse &&
+      frame_.impulses[impulseIndex_].point == point;
+    if (!matches) {
+      if (mismatches_ == 0) {
+        Console::log("[Warning] Replay diverged at frame %lu.", frameIndex_);
+      }
+      ++mismatches_;
+    }
+    ++impulseIndex_;
+  }
+}
+
+// Finish the current frame
+void
+Replay::endFrame() {
+  if (mode_ == Mode::Recording) {
+    writeFrame(frame_);
+    simulatedTime_ += frame_.dt;
+  }
+  else if (mode_ == Mode::Replaying) {
+    if (impulseIndex_ < frame_.impulses.size()) {
+      if (mismatches_ == 0) {
+        Console::log("[Warning] Replay diverged at frame %lu.", frameIndex_);
+      }
+      mismatches_ += frame_.impulses.size() - impulseIndex_;
+    }
+    simulatedTime_ += frame_.dt;
+    ++frameIndex_;
+  }
+}
+
+// Write a frame to the output file
+void
+Replay::writeFrame(const Frame& frame) {
+  writeValue(output_, frame.dt);
+  writeValue(output_, frame.mousePosition);
+  writeValue<sf::Uint16>(output_, frame.inputs.size());
+  for (const auto& in : frame.inputs) {
+    writeValue(output_, in.type);
+    writeValue(output_, in.code);
+  }
+  writeValue<sf::Uint16>(output_, frame.impulses.size());
+  for (const auto& imp : frame.impulses) {
+    writeValue(output_, imp.impulse);
+    writeValue(output_, imp.point);
+  }
+}
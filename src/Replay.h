@@ -0,0 +1,112 @@
+// Replay.h
+// Records and replays frames so that runs can be reproduced exactly
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <SFML/Graphics.hpp>
+
+// Static class that records or re-drives the game loop
+class Replay {
+  public:
+
+    // What the replay system is currently doing
+    enum Mode { Off, Recording, Replaying };
+
+    // Begin writing frames to a file
+    static bool startRecording(const std::string& fp, const sf::VideoMode& mode);
+
+    // Load a recording to drive the game with
+    static bool startReplaying(const std::string& fp);
+
+    // Close any open recording and report results
+    static void stop();
+
+    // Get what the replay system is doing
+    static Mode getMode();
+
+    // Get the video mode the recording was made with
+    static sf::VideoMode getVideoMode();
+
+    // Start recording a frame, called before events are handled
+    static void beginFrame(const sf::Time& dt);
+
+    // Get the next recorded frame, returns false when the replay has finished
+    static bool readFrame(sf::Time& dt, std::vector<sf::Event>& events);
+
+    // Record an input event that reached the scene
+    static void recordEvent(const sf::Event& ev);
+
+    // Record where the mouse is this frame
+    static void recordMousePosition(const sf::Vector2f& pos);
+
+    // Get where the mouse was when recording this frame
+    static sf::Vector2f getMousePosition();
+
+    // Record an impulse, or check it against the recording
+    static void logImpulse(const sf::Vector2f& impulse, const sf::Vector2f& point);
+
+    // Finish the current frame
+    static void endFrame();
+
+  private:
+
+    // An input event in a compact form
+    struct Input {
+      sf::Uint8 type;
+      sf::Int32 code;
+    };
+
+    // An impulse applied to a body
+    struct Impulse {
+      sf::Vector2f impulse;
+      sf::Vector2f point;
+    };
+
+    // Everything needed to reproduce a frame
+    struct Frame {
+      sf::Int64 dt = 0;
+      sf::Vector2f mousePosition;
+      std::vector<Input> inputs;
+      std::vector<Impulse> impulses;
+    };
+
+    // Current mode
+    static Mode mode_;
+
+    // Video mode of the recording
+    static sf::VideoMode videoMode_;
+
+    // File being recorded to
+    static std::ofstream output_;
+
+    // Frame being recorded or replayed
+    static Frame frame_;
+
+    // Frames loaded for replaying
+    static std::vector<Frame> frames_;
+
+    // Index of the frame being replayed
+    static std::size_t frameIndex_;
+
+    // Index of the next impulse to check while replaying
+    static std::size_t impulseIndex_;
+
+    // Amount of impulses that didn't match the recording
+    static unsigned mismatches_;
+
+    // Total simulated time
+    static sf::Int64 simulatedTime_;
+
+    // Measures how long the recording or replay took
+    static sf::Clock clock_;
+
+    // Write a frame to the output file
+    static void writeFrame(const Frame& frame);
+};
+
+#endif
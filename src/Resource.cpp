@@ -3,86 +3,304 @@
 
 #include "Resource.h"
 
+#include <filesystem>
+
 // Avoid cyclic dependancies
 #include "Game.h"
 #include "Scripting.h"
+#include "ResourceLoader.h"
+#include "ScriptCache.h"
+#include "ScriptWatchdog.h"
+#include "AssetPack.h"
 
 #include "Scene.h"
 #include "Texture.h"
 #include "Font.h"
 #include "Animation.h"
 #include "Spell.h"
+#include "AnimationSet.h"
+
+// Counts every use of a resource so they can be ordered by how recently they were used
+static unsigned long useCounter = 0;
 
 // Get resource type from descriptor
 Resource::Resource(const std::string& fp)
   : filepath_(fp)
   , type_(Type::UNKNOWN)
-  , resource_(nullptr) {
+  , resource_(nullptr)
+  , refCount_(0)
+  , lastUsed_(0)
+  , memoryUsage_(0) {
+  execute();
+}
 
-  // Try to execute the file
-  std::tuple<Resource::Type, std::string, sol::object> result;
-  auto attempt = Game::lua.script_file(filepath_, &sol::script_pass_on_error);
-  if (!attempt.valid()) {
-    sol::error err = attempt;
-    Console::log("[Error] in %s:\n> %s", filepath_.c_str(), err.what());
-    return;
+// Use a descriptor that was already evaluated
+Resource::Resource(const std::string& fp, const ResourceDescriptor& descriptor)
+  : filepath_(fp)
+  , name_(descriptor.name)
+  , type_(descriptor.type)
+  , resource_(nullptr)
+  , refCount_(0)
+  , lastUsed_(0)
+  , memoryUsage_(0) {
+  if (descriptor.data) {
+    data_ = descriptor.data(Game::lua);
   }
-
-  // If it was valid, return the type
-  result = attempt;
-  type_ = std::get<0>(result);
-  name_ = std::get<1>(result);
 }
 
-// Load and/or get the resource
+// Load and/or get the resource, waiting for any background loading
 void*
 Resource::get() {
 
+  // Remember that the resource is still in use
+  lastUsed_ = ++useCounter;
+
+  // Finish loading in the background first
+  if (isLoading()) {
+    pending_.wait();
+    finishLoading();
+  }
+
   // Easy out if resource is loaded
   if (resource_ != nullptr) return resource_;
 
-  // Ensure resource_ is nullptr to start with
-  resource_ = nullptr;
+  // Create the resource and load any of it's data now
+  create();
+  if (type_ == Type::TEXTURE && resource_ != nullptr) {
+    static_cast<Texture*>(resource_)->load();
+  }
+  updateMemoryUsage();
 
-  // Otherwise, execute the file
-  std::tuple<Resource::Type, std::string, sol::object> result;
-  auto attempt = Game::lua.script_file(filepath_, &sol::script_pass_on_error);
-  if (!attempt.valid()) {
-    sol::error err = attempt;
-    Console::log("[Error] in %s:\n> %s", filepath_.c_str(), err.what());
+  // Return resource no matter what
+  return resource_;
+}
+
+// Start loading the resource in the background if it can be
+ResourceFuture
+Resource::getAsync() {
+
+  // Easy out if resource is loaded or loading
+  lastUsed_ = ++useCounter;
+  if (resource_ != nullptr) return ResourceFuture(this);
+
+  // Only textures have slow work that can be done on another thread
+  if (type_ != Type::TEXTURE) {
+    get();
+    return ResourceFuture(this);
+  }
+
+  // Decode on a worker and upload once it's done
+  Texture* texture = static_cast<Texture*>(create());
+  if (texture != nullptr) {
+    pending_ = ResourceLoader::submit(
+      [texture]() { return texture->decode(); },
+      [this]() { finishLoading(); });
+  }
+  return ResourceFuture(this);
+}
+
+// Check whether the resource is still loading in the background
+bool
+Resource::isLoading() const {
+  return pending_.valid();
+}
+
+// Build the resource object from the descriptor's data
+void*
+Resource::create() {
+
+  // The descriptor only needs to run again if the resource was released
+  if (!data_.valid() && !execute()) {
     return resource_;
   }
 
-  // Interpret and cast the second
-  result = attempt;
-  type_ = std::get<0>(result);
-  sol::object data = std::get<2>(result);
+  // Interpret and cast the data
   switch (type_) {
     case Type::SCENE:
-      resource_ = new Scene(data.as<Scene>()); break;
+      resource_ = new Scene(data_.as<Scene>()); break;
     case Type::TEXTURE:
-      resource_ = new Texture(data.as<Texture>()); break;
+      resource_ = new Texture(data_.as<Texture>()); break;
     case Type::FONT:
-      resource_ = new Font(data.as<Font>()); break;
+      resource_ = new Font(data_.as<Font>()); break;
     case Type::ANIMATION:
-      resource_ = new Animation(data.as<Animation>()); break;
+      resource_ = new Animation(data_.as<Animation>()); break;
     case Type::SPELL:
-      resource_ = new Spell(data.as<Spell>()); break;
+      resource_ = new Spell(data_.as<Spell>()); break;
+    case Type::ANIMATIONSET:
+      resource_ = new AnimationSet(data_.as<AnimationSet>());
+      static_cast<AnimationSet*>(resource_)->resolve();
+      break;
     default:
       break;
   }
 
-  // Return resource no matter what
+  // Let Lua collect its copy now that we have our own
+  data_ = sol::object();
   return resource_;
 }
 
+// Complete background loading on the main thread
+void
+Resource::finishLoading() {
+
+  // Easy out if this was already finished or cancelled
+  if (!isLoading()) { return; }
+
+  // Upload whatever was decoded
+  pending_.wait();
+  pending_ = std::shared_future<bool>();
+  if (type_ == Type::TEXTURE && resource_ != nullptr) {
+    static_cast<Texture*>(resource_)->upload();
+  }
+  updateMemoryUsage();
+}
+
+// Check whether the resource could be released to save memory
+bool
+Resource::isEvictable() const {
+  return (type_ == Type::TEXTURE || type_ == Type::FONT) && 
+    resource_ != nullptr && refCount_ == 0 && !isLoading();
+}
+
+// Work out how much memory the loaded resource takes up
+void
+Resource::updateMemoryUsage() {
+  memoryUsage_ = 0;
+  if (resource_ == nullptr) { return; }
+
+  // Textures take four bytes per pixel
+  if (type_ == Type::TEXTURE) {
+    const sf::Vector2u size = static_cast<Texture*>(resource_)->getTexture().getSize();
+    memoryUsage_ = size.x * size.y * 4;
+  }
+
+  // Fonts keep their whole file in memory
+  else if (type_ == Type::FONT) {
+    const std::string fp = static_cast<Font*>(resource_)->getFilepath();
+    const AssetPack::Entry* packed = AssetPack::find(fp);
+    std::error_code ec;
+    memoryUsage_ = packed != nullptr ? packed->size : std::filesystem::file_size(fp, ec);
+    if (ec) { memoryUsage_ = 0; }
+  }
+}
+
+// Execute the descriptor and store what it returns
+bool
+Resource::execute() {
+
+  // Load the file, precompiled if possible
+  sol::protected_function chunk;
+  std::string error;
+  if (!ScriptCache::load(Game::lua, filepath_, chunk, error)) {
+    Console::log("[Error] in %s:\n> %s", filepath_.c_str(), error.c_str());
+    return false;
+  }
+
+  // Try to execute the file
+  ScriptWatchdog::Budget budget(filepath_.c_str(), ScriptWatchdog::getLoadingLimits());
+  auto attempt = chunk();
+  if (!attempt.valid()) {
+    sol::error err = attempt;
+    Console::log("[Error] in %s:\n> %s", filepath_.c_str(), err.what());
+    return false;
+  }
+
+  // If it was valid, keep the type, name and data
+  std::tuple<Resource::Type, std::string, sol::object> result = attempt;
+  type_ = std::get<0>(result);
+  name_ = std::get<1>(result);
+  data_ = std::get<2>(result);
+  return true;
+}
+
 // Force release of resource
 void 
 Resource::release() {
+
+  // Workers may still be writing to the resource
+  if (isLoading()) {
+    pending_.wait();
+    pending_ = std::shared_future<bool>();
+  }
+
+  // Delete the resource
   if (resource_ != nullptr) {
     deleteResource();
     resource_ = nullptr;
   }
+  memoryUsage_ = 0;
+}
+
+// Get the file the resource's data is read from, if it isn't the descriptor
+std::string
+Resource::getDataFilepath() const {
+  if (resource_ == nullptr) { return ""; }
+  switch (type_) {
+    case Type::TEXTURE:
+      return static_cast<const Texture*>(resource_)->getFilepath();
+    case Type::FONT:
+      return static_cast<const Font*>(resource_)->getFilepath();
+    default:
+      return "";
+  }
+}
+
+// Run the descriptor again and update the resource in place
+bool
+Resource::reload() {
+
+  // Finish loading in the background first
+  if (isLoading()) {
+    pending_.wait();
+    finishLoading();
+  }
+
+  // Resources that aren't loaded only need new data
+  const Type oldType = type_;
+  const std::string oldName = name_;
+  if (!execute()) { return false; }
+  if (resource_ == nullptr) { return true; }
+
+  // The resource has to stay the same type to be swapped
+  if (type_ != oldType) {
+    Console::log("[Error] Cannot reload %s as it's type has changed.", oldName.c_str());
+    type_ = oldType;
+    data_ = sol::object();
+    return false;
+  }
+  if (name_ != oldName) {
+    Console::log("[Warning] %s was renamed, the new name is used after a restart.", oldName.c_str());
+    name_ = oldName;
+  }
+
+  // Copy the new version over the old one
+  switch (type_) {
+    case Type::TEXTURE:
+      *static_cast<Texture*>(resource_) = data_.as<Texture>();
+      static_cast<Texture*>(resource_)->load();
+      updateMemoryUsage();
+      break;
+    case Type::FONT:
+      *static_cast<Font*>(resource_) = data_.as<Font>();
+      updateMemoryUsage();
+      break;
+    case Type::ANIMATION:
+      *static_cast<Animation*>(resource_) = data_.as<Animation>(); break;
+    case Type::SPELL:
+      *static_cast<Spell*>(resource_) = data_.as<Spell>(); break;
+    case Type::ANIMATIONSET:
+      *static_cast<AnimationSet*>(resource_) = data_.as<AnimationSet>();
+      static_cast<AnimationSet*>(resource_)->resolve();
+      break;
+    default:
+      Console::log("[Warning] %s can't be reloaded while it's in use.", name_.c_str());
+      data_ = sol::object();
+      return false;
+  }
+
+  // Let Lua collect its copy
+  data_ = sol::object();
+  return true;
 }
 
 // Get resource via *
@@ -111,7 +329,15 @@ Resource::deleteResource() {
       delete static_cast<Animation*>(resource_); break;
     case Type::SPELL:
       delete static_cast<Spell*>(resource_); break;
+    case Type::ANIMATIONSET:
+      delete static_cast<AnimationSet*>(resource_); break;
     default:
       break;
   }
 }
+
+// Get the resource object, which may not be ready to use yet
+void*
+ResourceFuture::peek() const {
+  return resource_ != nullptr ? resource_->resource_ : nullptr;
+}
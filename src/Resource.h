@@ -4,12 +4,34 @@
 #ifndef RESOURCE_H
 #define RESOURCE_H
 
+#include <functional>
+#include <future>
 #include <string>
+#include <vector>
+
+#include "Sol.h"
+
+// Avoid cyclic dependencies
+class ResourceFuture;
+struct ResourceDescriptor;
+template <typename T> class ResourceHandle;
+class Scene;
+class Texture;
+class Font;
+class Animation;
+class Spell;
+class AnimationSet;
 
 // Base class for all resource functionalities
 class Resource {
   public:
 
+    // Allow futures to see the resource while it's loading
+    friend class ResourceFuture;
+
+    // Allow handles to count references
+    template <typename T> friend class ResourceHandle;
+
     // Resource type
     enum Type {
       UNKNOWN,
@@ -17,23 +39,57 @@ class Resource {
       TEXTURE,
       FONT,
       ANIMATION,
-      SPELL
+      SPELL,
+      ANIMATIONSET
     };
 
     // Constructors
-    Resource() : filepath_(""), type_(Type::UNKNOWN), resource_(nullptr) {}
+    Resource() : filepath_(""), type_(Type::UNKNOWN), resource_(nullptr), 
+      refCount_(0), lastUsed_(0), memoryUsage_(0) {}
     Resource(const std::string& fp);
 
+    // Use a descriptor that was already evaluated, rather than running the file
+    Resource(const std::string& fp, const ResourceDescriptor& descriptor);
+
     // Destructor
     ~Resource() {}
 
     // Get private variables
     Type getType() const { return type_; }
     std::string getName() const { return name_; }
+    std::string getFilepath() const { return filepath_; }
 
-    // Load and/or get the resource
+    // Get the file the resource's data is read from, if it isn't the descriptor
+    std::string getDataFilepath() const;
+
+    // Run the descriptor again and update the resource in place
+    // Anything pointing at the resource sees the new version
+    bool reload();
+
+    // Load and/or get the resource, waiting for any background loading
     void* get();
 
+    // Start loading the resource in the background if it can be
+    ResourceFuture getAsync();
+
+    // Check whether the resource is still loading in the background
+    bool isLoading() const;
+
+    // Check whether the resource is loaded
+    bool isLoaded() const { return resource_ != nullptr; }
+
+    // Get how many handles refer to this resource
+    unsigned getRefCount() const { return refCount_; }
+
+    // Get when the resource was last used, larger is more recent
+    unsigned long getLastUsed() const { return lastUsed_; }
+
+    // Get roughly how many bytes the loaded resource takes up
+    std::size_t getMemoryUsage() const { return memoryUsage_; }
+
+    // Check whether the resource could be released to save memory
+    bool isEvictable() const;
+
     // Force release of resource
     void release();
 
@@ -55,8 +111,126 @@ class Resource {
     // The resource within
     void* resource_;
 
+    // Object returned by the descriptor, kept until the resource is built
+    sol::object data_;
+
+    // Result of background loading, valid while loading
+    std::shared_future<bool> pending_;
+
+    // Amount of handles referring to this resource
+    unsigned refCount_;
+
+    // When the resource was last used
+    unsigned long lastUsed_;
+
+    // Bytes taken up by the loaded resource
+    std::size_t memoryUsage_;
+
+    // Work out how much memory the loaded resource takes up
+    void updateMemoryUsage();
+
+    // Execute the descriptor and store what it returns
+    bool execute();
+
+    // Build the resource object from the descriptor's data
+    void* create();
+
+    // Complete background loading on the main thread
+    void finishLoading();
+
     // Delete the resource depending on it's type
     void deleteResource();
 };
 
+// Handle to a resource that may still be loading in the background
+class ResourceFuture {
+  public:
+
+    // Constructor
+    ResourceFuture(Resource* resource = nullptr) : resource_(resource) {}
+
+    // Check whether this refers to a resource
+    bool isValid() const { return resource_ != nullptr; }
+
+    // Check whether the resource has finished loading
+    bool isReady() const { return resource_ != nullptr && !resource_->isLoading(); }
+
+    // Get the resource object, which may not be ready to use yet
+    void* peek() const;
+
+    // Wait for the resource to finish loading and get it
+    void* wait() const { return resource_ != nullptr ? resource_->get() : nullptr; }
+
+  private:
+
+    // The resource being loaded
+    Resource* resource_;
+};
+
+// What a descriptor returned, copied out of the Lua state that evaluated it
+struct ResourceDescriptor {
+  Resource::Type type = Resource::Type::UNKNOWN;
+  std::string name;
+
+  // Makes a copy of the resource's data in another Lua state
+  std::function<sol::object(sol::state_view)> data;
+
+  // Anything printed while it was evaluated, shown once the result is used
+  std::vector<std::string> output;
+};
+
+// Maps each resource class to its type
+template <typename T> struct ResourceTraits;
+template <> struct ResourceTraits<Scene> { static const Resource::Type type = Resource::Type::SCENE; };
+template <> struct ResourceTraits<Texture> { static const Resource::Type type = Resource::Type::TEXTURE; };
+template <> struct ResourceTraits<Font> { static const Resource::Type type = Resource::Type::FONT; };
+template <> struct ResourceTraits<Animation> { static const Resource::Type type = Resource::Type::ANIMATION; };
+template <> struct ResourceTraits<Spell> { static const Resource::Type type = Resource::Type::SPELL; };
+template <> struct ResourceTraits<AnimationSet> { static const Resource::Type type = Resource::Type::ANIMATIONSET; };
+
+// Typed handle to a resource, the resource won't be evicted while handles exist
+template <typename T>
+class ResourceHandle {
+  public:
+
+    // Constructors
+    ResourceHandle(Resource* resource = nullptr) : resource_(resource) { addRef(); }
+    ResourceHandle(const ResourceHandle& other) : resource_(other.resource_) { addRef(); }
+
+    // Destructor
+    ~ResourceHandle() { removeRef(); }
+
+    // Point at another resource
+    ResourceHandle& operator=(const ResourceHandle& other) {
+      if (other.resource_ != resource_) {
+        removeRef();
+        resource_ = other.resource_;
+        addRef();
+      }
+      return *this;
+    }
+
+    // Load and/or get the resource
+    T* get() const { return resource_ != nullptr ? static_cast<T*>(resource_->get()) : nullptr; }
+    T* operator->() const { return get(); }
+
+    // Check whether this refers to a resource
+    explicit operator bool() const { return resource_ != nullptr; }
+
+    // Get the untyped resource
+    Resource* getResource() const { return resource_; }
+
+    // Stop referring to the resource
+    void reset() { removeRef(); resource_ = nullptr; }
+
+  private:
+
+    // The resource referred to
+    Resource* resource_;
+
+    // Count references
+    void addRef() { if (resource_ != nullptr) { ++resource_->refCount_; } }
+    void removeRef() { if (resource_ != nullptr) { --resource_->refCount_; } }
+};
+
 #endif
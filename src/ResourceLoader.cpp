@@ -0,0 +1,156 @@
+// ResourceLoader.cpp
+// Worker threads that load resources in the background
+
+#include "ResourceLoader.h"
+
+#include <algorithm>
+
+// Avoid cyclic dependencies
+#include "Console.h"
+
+// Initialise static members
+std::vector<std::thread> ResourceLoader::workers_;
+std::deque<ResourceLoader::Job> ResourceLoader::jobs_;
+std::vector<std::function<void()>> ResourceLoader::completed_;
+std::mutex ResourceLoader::mutex_;
+std::condition_variable ResourceLoader::condition_;
+std::size_t ResourceLoader::pendingCount_ = 0;
+bool ResourceLoader::isRunning_ = false;
+
+// Start the worker threads
+void
+ResourceLoader::start(unsigned threadCount) {
+
+  // Easy out
+  if (isRunning_) { return; }
+
+  // Leave a core for the main thread, but don't go overboard
+  if (threadCount == 0) {
+    const unsigned cores = std::thread::hardware_concurrency();
+    threadCount = std::max(1u, std::min(4u, cores > 1 ? cores - 1 : 1u));
+  }
+
+  // Start working
+  isRunning_ = true;
+  for (unsigned i = 0; i < threadCount; ++i) {
+    workers_.emplace_back(ResourceLoader::handleWorkerThread);
+  }
+  Console::log("Started %u resource loading threads.", threadCount);
+}
+
+// Stop the worker threads, work that hasn't started is cancelled
+void
+ResourceLoader::stop() {
+
+  // Easy out
+  if (!isRunning_) { return; }
+
+  // Cancel queued jobs so nobody waits on them forever
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    isRunning_ = false;
+    for (auto& job : jobs_) {
+      job.promise->set_value(false);
+    }
+    pendingCount_ -= jobs_.size();
+    jobs_.clear();
+  }
+  condition_.notify_all();
+
+  // Let the workers finish what they are doing
+  for (auto& worker : workers_) {
+    if (worker.joinable()) { worker.join(); }
+  }
+  workers_.clear();
+
+  // Finish anything that completed
+  update();
+}
+
+// Queue work to run on a worker thread
+std::shared_future<bool>
+ResourceLoader::submit(const std::function<bool()>& work, const std::function<void()>& finish) {
+
+  // Prepare the job
+  Job job;
+  job.work = work;
+  job.finish = finish;
+  job.promise = std::make_shared<std::promise<bool>>();
+  std::shared_future<bool> future = job.promise->get_future().share();
+
+  // Without workers, do the work now
+  if (!isRunning_) {
+    job.promise->set_value(job.work());
+    std::lock_guard<std::mutex> lock(mutex_);
+    completed_.push_back(job.finish);
+    return future;
+  }
+
+  // Hand the job to a worker
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back(job);
+    ++pendingCount_;
+  }
+  condition_.notify_one();
+  return future;
+}
+
+// Run the finish callbacks of completed work
+void
+ResourceLoader::update() {
+
+  // Take the callbacks so they can run without holding the lock
+  std::vector<std::function<void()>> completed;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    completed.swap(completed_);
+  }
+
+  // Finish every job
+  for (auto& finish : completed) {
+    if (finish) { finish(); }
+  }
+}
+
+// Check whether there is completed work waiting for update()
+bool
+ResourceLoader::hasCompleted() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return !completed_.empty();
+}
+
+// Get the amount of jobs waiting for or being worked on
+std::size_t
+ResourceLoader::getPendingCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pendingCount_;
+}
+
+// Loop run by every worker thread
+void
+ResourceLoader::handleWorkerThread() {
+  while (true) {
+
+    // Wait for a job or for the loader to stop
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, []() { return !isRunning_ || !jobs_.empty(); });
+      if (jobs_.empty()) { return; }
+      job = jobs_.front();
+      jobs_.pop_front();
+    }
+
+    // Do the work
+    const bool success = job.work();
+
+    // Hand the result back to the main thread
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      completed_.push_back(job.finish);
+      --pendingCount_;
+    }
+    job.promise->set_value(success);
+  }
+}
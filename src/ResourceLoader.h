@@ -0,0 +1,74 @@
+// ResourceLoader.h
+// Worker threads that load resources in the background
+
+#ifndef RESOURCELOADER_H
+#define RESOURCELOADER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Static class that runs slow loading work away from the main thread
+class ResourceLoader {
+  public:
+
+    // Start the worker threads, 0 picks a count based on the hardware
+    static void start(unsigned threadCount = 0);
+
+    // Stop the worker threads, work that hasn't started is cancelled
+    static void stop();
+
+    // Queue work to run on a worker thread
+    // finish is called on the main thread by update() once work is done
+    static std::shared_future<bool> submit(
+      const std::function<bool()>& work, const std::function<void()>& finish);
+
+    // Run the finish callbacks of completed work, call on the main thread
+    static void update();
+
+    // Check whether there is completed work waiting for update()
+    static bool hasCompleted();
+
+    // Get the amount of jobs waiting for or being worked on
+    static std::size_t getPendingCount();
+
+  private:
+
+    // A unit of work and what to do afterwards
+    struct Job {
+      std::function<bool()> work;
+      std::function<void()> finish;
+      std::shared_ptr<std::promise<bool>> promise;
+    };
+
+    // Worker threads
+    static std::vector<std::thread> workers_;
+
+    // Jobs waiting to be picked up
+    static std::deque<Job> jobs_;
+
+    // Finish callbacks waiting for the main thread
+    static std::vector<std::function<void()>> completed_;
+
+    // Guards jobs_, completed_ and pendingCount_
+    static std::mutex mutex_;
+
+    // Wakes workers when jobs are added
+    static std::condition_variable condition_;
+
+    // Amount of jobs not yet finished
+    static std::size_t pendingCount_;
+
+    // Whether workers should keep running
+    static bool isRunning_;
+
+    // Loop run by every worker thread
+    static void handleWorkerThread();
+};
+
+#endif
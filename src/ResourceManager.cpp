@@ -6,22 +6,88 @@
 // Avoid cyclic dependancies
 #include "Game.h"
 #include "Scripting.h"
+#include "ResourceLoader.h"
+#include "AssetPack.h"
+#include "ScriptCache.h"
+
+#include "Texture.h"
+#include "Font.h"
+#include "Animation.h"
+#include "AnimationSet.h"
+
+#include <algorithm>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
 
 // Initialise static members
 std::map<std::string, Resource> ResourceManager::resources_;
+std::vector<Resource*> ResourceManager::resourceTable_;
+std::set<NameID>* ResourceManager::recording_ = nullptr;
 Resource ResourceManager::nullResource_;
+int ResourceManager::watchFd_ = -1;
+std::map<int, std::string> ResourceManager::watchedDirs_;
+std::map<std::string, float> ResourceManager::changedFiles_;
+sf::Clock ResourceManager::watchClock_;
+std::size_t ResourceManager::memoryBudget_ = 256 * 1024 * 1024;
+std::size_t ResourceManager::residentMemory_ = 0;
+std::size_t ResourceManager::evictedMemory_ = 0;
+unsigned ResourceManager::evictionCount_ = 0;
+
+// Wait this long after a file changes before reloading, editors often write more than once
+static const float reloadDelay = 0.15f;
+
+// Time that may be spent reloading each frame
+static const float reloadBudget = 0.002f;
+
+// Make paths comparable no matter how they were written
+static std::string
+normalisePath(const std::string& path) {
+  return std::filesystem::path(path).lexically_normal().generic_string();
+}
 
 // Registers resource types to files during initialisation
 void
 ResourceManager::registerResourceTypes() {
-  Game::lua.set("Resource_UNKNOWN", Resource::Type::UNKNOWN);
-  Game::lua.set("Resource_SCENE", Resource::Type::SCENE);
-  Game::lua.set("Resource_TEXTURE", Resource::Type::TEXTURE);
-  Game::lua.set("Resource_FONT", Resource::Type::FONT);
-  Game::lua.set("Resource_ANIMATION", Resource::Type::ANIMATION);
-  Game::lua.set("Resource_SPELL", Resource::Type::SPELL);
+  registerResourceConstants(Game::lua);
+
+  // Allow scripts to control resource memory
+  Game::lua.set("Resources", ResourceManager());
+  Game::lua.new_usertype<ResourceManager>("ResourceManager",
+    "memoryBudget", sol::property(
+      &ResourceManager::getMemoryBudget,
+      &ResourceManager::setMemoryBudget),
+    "residentMemory", sol::property(&ResourceManager::getResidentMemory),
+    "evictedMemory", sol::property(&ResourceManager::getEvictedMemory),
+    "id", [](const std::string& name) { return StringTable::intern(name); }
+  );
+
+  // Add to auto complete
+  Console::addCommand("[Class] Resources");
+  Console::addCommand("Resources.memoryBudget");
+  Console::addCommand("Resources.residentMemory");
+  Console::addCommand("Resources.evictedMemory");
+  Console::addCommand("Resources.id");
+}
+
+// Register resource type names to a Lua state
+void
+ResourceManager::registerResourceConstants(sol::state_view lua) {
+  lua.set("Resource_UNKNOWN", Resource::Type::UNKNOWN);
+  lua.set("Resource_SCENE", Resource::Type::SCENE);
+  lua.set("Resource_TEXTURE", Resource::Type::TEXTURE);
+  lua.set("Resource_FONT", Resource::Type::FONT);
+  lua.set("Resource_ANIMATION", Resource::Type::ANIMATION);
+  lua.set("Resource_SPELL", Resource::Type::SPELL);
+  lua.set("Resource_ANIMATIONSET", Resource::Type::ANIMATIONSET);
 }
 
+// Names of each resource type for reports
+static const char* typeNames[] = { "unknown", "scene", "texture", "font", "animation", "spell", "animation set" };
+
 // Import all files from a folder
 void
 ResourceManager::loadResources(const std::string& dir) {
@@ -29,30 +95,189 @@ ResourceManager::loadResources(const std::string& dir) {
   // Declare that we're loading resources
   Console::log("Loading resources recursively from directory: '%s'..", dir.c_str());
 
-  // For every file in the directory
-  for (const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
-    const auto fp = entry.path();
-    if (entry.is_regular_file() && fp.extension().string() == ".lua") {
-      Resource resource(fp.string());
-      const std::string name = resource.getName();
-      if (resource.getType() != Resource::Type::UNKNOWN && name != "") {
-        resources_[name] = resource;
-        Console::log("Loaded resource: %s", name.c_str());
+  // Keep track of how long each type of resource takes
+  const int typeCount = sizeof(typeNames) / sizeof(typeNames[0]);
+  int counts[typeCount] = {};
+  float times[typeCount] = {};
+  std::string slowestName;
+  float slowestTime = 0.f;
+  sf::Clock totalClock;
+
+  // Find descriptors in the asset pack, or walk the directory without one
+  std::vector<std::string> descriptors;
+  if (AssetPack::isOpen()) {
+    descriptors = AssetPack::getScripts(dir);
+  }
+  else {
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+      if (entry.is_regular_file() && entry.path().extension().string() == ".lua") {
+        descriptors.push_back(entry.path().string());
       }
     }
   }
+
+  // Evaluate descriptors on the worker threads, each has a Lua state of its own
+  std::vector<ResourceDescriptor> evaluated(descriptors.size());
+  std::vector<float> evaluateTimes(descriptors.size(), 0.f);
+  std::vector<std::shared_future<bool>> futures;
+  futures.reserve(descriptors.size());
+  for (std::size_t i = 0; i < descriptors.size(); ++i) {
+    futures.push_back(ResourceLoader::submit([&descriptors, &evaluated, &evaluateTimes, i]() {
+      sf::Clock clock;
+      const bool success = evaluateDescriptor(descriptors[i], evaluated[i]);
+      evaluateTimes[i] = clock.getElapsedTime().asSeconds() * 1000.f;
+      return success;
+    }, std::function<void()>()));
+  }
+
+  // Create every resource in order, running descriptors with Lua functions in the main state
+  int parallelCount = 0;
+  for (std::size_t i = 0; i < descriptors.size(); ++i) {
+    const std::string& fp = descriptors[i];
+    const bool isEvaluated = futures[i].get();
+    sf::Clock clock;
+    if (isEvaluated) {
+      for (const auto& message : evaluated[i].output) {
+        Console::log("%s", message.c_str());
+      }
+    }
+    Resource resource = isEvaluated ? Resource(fp, evaluated[i]) : Resource(fp);
+    const float time = clock.getElapsedTime().asSeconds() * 1000.f + evaluateTimes[i];
+    const std::string name = resource.getName();
+    parallelCount += isEvaluated;
+    if (resource.getType() != Resource::Type::UNKNOWN && name != "") {
+      resources_[name] = resource;
+
+      // Resolve the name once so it can be found by ID
+      const NameID id = StringTable::intern(name);
+      if (resourceTable_.size() <= id) { resourceTable_.resize(id + 1, nullptr); }
+      resourceTable_[id] = &resources_[name];
+      Console::log("Loaded resource: %s", name.c_str());
+
+      // Add to the report
+      counts[resource.getType()] += 1;
+      times[resource.getType()] += time;
+      if (time > slowestTime) {
+        slowestTime = time;
+        slowestName = name;
+      }
+    }
+  }
+
+  // Report how long loading took
+  int total = 0;
+  std::string breakdown;
+  for (int i = 0; i < typeCount; ++i) {
+    if (counts[i] == 0) { continue; }
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s%d %s in %.1fms", 
+      breakdown.empty() ? "" : ", ", counts[i], typeNames[i], times[i]);
+    breakdown += buf;
+    total += counts[i];
+  }
+  Console::log("Loaded %d resources in %.1fms (%s).", 
+    total, totalClock.getElapsedTime().asSeconds() * 1000.f, breakdown.c_str());
+  if (!slowestName.empty()) {
+    Console::log("Slowest resource: %s (%.1fms)", slowestName.c_str(), slowestTime);
+  }
+  Console::log("Evaluated %d of %lu descriptors on worker threads.", parallelCount, descriptors.size());
+  Console::log("Script cache: %u loaded from cache, %u compiled.",
+    ScriptCache::getHitCount(), ScriptCache::getMissCount());
+
+  // Decode textures in the background while the game starts
+  for (auto& entry : resources_) {
+    if (entry.second.getType() == Resource::Type::TEXTURE) {
+      entry.second.getAsync();
+    }
+  }
+}
+
+// Copies a descriptor's data out of the state that evaluated it
+template <typename T> static bool
+copyDescriptorData(const sol::object& data, ResourceDescriptor& descriptor) {
+  if (!data.is<T>()) { return false; }
+  const T copy = data.as<T>();
+  descriptor.data = [copy](sol::state_view lua) { return sol::make_object(lua, copy); };
+  return true;
+}
+
+// Evaluate a descriptor in this thread's own Lua state
+bool
+ResourceManager::evaluateDescriptor(const std::string& fp, ResourceDescriptor& descriptor) {
+
+  // Each thread has a state of its own that only knows about resources made of plain data
+  // Scenes and spells aren't registered, so their descriptors stop here and run again in the main state
+  thread_local sol::state lua;
+  thread_local std::vector<std::string> output;
+  thread_local bool isReady = false;
+  if (!isReady) {
+    lua.open_libraries(sol::lib::base);
+
+    // Hold on to printed text, it's only shown if the main state doesn't run the descriptor again
+    lua.set_function("print", [](const std::string& message) { output.push_back(message); });
+    registerResourceConstants(lua);
+    Script::Funcs::registerRects(lua);
+    Texture::registerTextureType(lua);
+    Font::registerFontType(lua);
+    Animation::registerAnimationType(lua);
+    AnimationSet::registerAnimationSetType(lua);
+    isReady = true;
+  }
+
+  // Load and run the file, errors are reported when it runs again in the main state
+  output.clear();
+  sol::protected_function chunk;
+  std::string error;
+  if (!ScriptCache::load(lua, fp, chunk, error)) { return false; }
+  auto attempt = chunk();
+  if (!attempt.valid()) { return false; }
+
+  // Copy out the result, anything holding Lua functions has to live in the main state
+  std::tuple<Resource::Type, std::string, sol::object> result = attempt;
+  descriptor.type = std::get<0>(result);
+  descriptor.name = std::get<1>(result);
+  const sol::object& data = std::get<2>(result);
+  descriptor.output.swap(output);
+  switch (descriptor.type) {
+    case Resource::Type::TEXTURE:
+      return copyDescriptorData<Texture>(data, descriptor);
+    case Resource::Type::FONT:
+      return copyDescriptorData<Font>(data, descriptor);
+    case Resource::Type::ANIMATION:
+      return copyDescriptorData<Animation>(data, descriptor);
+    case Resource::Type::ANIMATIONSET:
+      return copyDescriptorData<AnimationSet>(data, descriptor);
+    default:
+      return false;
+  }
 }
 
 // Get a resource by name, or a null resource
 Resource&
 ResourceManager::getResource(const std::string& name) {
-  auto it = resources_.find(name);
-  if (it != resources_.end()) {
-    return it->second;
+  return getResource(StringTable::find(name));
+}
+
+// Get a resource by interned name, or a null resource
+Resource&
+ResourceManager::getResource(NameID id) {
+  if (id < resourceTable_.size() && resourceTable_[id] != nullptr) {
+
+    // Scenes aren't something another scene depends on
+    if (recording_ != nullptr && resourceTable_[id]->getType() != Resource::Type::SCENE) {
+      recording_->insert(id);
+    }
+    return *resourceTable_[id];
   }
   return nullResource_;
 }
 
+// Record the name of every resource looked up into a set
+void
+ResourceManager::recordDependencies(std::set<NameID>* dependencies) {
+  recording_ = dependencies;
+}
+
 // Delete all resources
 void
 ResourceManager::releaseResources() {
@@ -66,6 +291,205 @@ ResourceManager::releaseResources() {
     r.release();
   }
 
+  // Let go of callbacks that refer to these resources
+  ResourceLoader::update();
+
   // Clear the map
+  resourceTable_.clear();
   resources_.clear();
 }
+
+// Watch a folder and reload resources when their files change
+void
+ResourceManager::watchResources(const std::string& dir) {
+#ifdef __linux__
+
+  // Start listening without blocking the game
+  stopWatching();
+  watchFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (watchFd_ < 0) {
+    Console::log("[Warning] Could not watch %s for changes.", dir.c_str());
+    return;
+  }
+
+  // Watches only cover one directory, so add every subdirectory
+  addWatch(dir);
+  for (const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+    if (entry.is_directory()) {
+      addWatch(entry.path().string());
+    }
+  }
+  Console::log("Watching %lu directories in '%s' for changes.", watchedDirs_.size(), dir.c_str());
+
+#else
+  Console::log("[Note] Reloading resources when they change is only supported on Linux.");
+#endif
+}
+
+// Collect changed files, called every frame
+void
+ResourceManager::updateWatch() {
+#ifdef __linux__
+
+  // Easy out
+  if (watchFd_ < 0) { return; }
+
+  // Collect changes since last frame
+  const float now = watchClock_.getElapsedTime().asSeconds();
+  alignas(inotify_event) char buffer[4096];
+  ssize_t length;
+  while ((length = read(watchFd_, buffer, sizeof(buffer))) > 0) {
+    for (char* ptr = buffer; ptr < buffer + length; ) {
+      const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+      ptr += sizeof(inotify_event) + event->len;
+      auto dir = watchedDirs_.find(event->wd);
+      if (event->len == 0 || dir == watchedDirs_.end()) { continue; }
+      const std::string fp = normalisePath(dir->second + "/" + event->name);
+
+      // Watch new directories, remember changed files
+      if ((event->mask & IN_CREATE) && (event->mask & IN_ISDIR)) {
+        addWatch(fp);
+      }
+      else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+        changedFiles_[fp] = now;
+      }
+    }
+  }
+
+#endif
+}
+
+// Check if changed files have settled and can be reloaded
+bool
+ResourceManager::hasSettledChanges() {
+  const float now = watchClock_.getElapsedTime().asSeconds();
+  for (const auto& file : changedFiles_) {
+    if (now - file.second >= reloadDelay) { return true; }
+  }
+  return false;
+}
+
+// Reload resources whose files have settled, but don't stall the frame
+void
+ResourceManager::reloadChanges() {
+  const float now = watchClock_.getElapsedTime().asSeconds();
+  sf::Clock budget;
+  for (auto it = changedFiles_.begin(); it != changedFiles_.end(); ) {
+    if (budget.getElapsedTime().asSeconds() > reloadBudget) { break; }
+    if (now - it->second < reloadDelay) { ++it; continue; }
+    reloadFile(it->first);
+    it = changedFiles_.erase(it);
+  }
+}
+
+// Stop watching for changes
+void
+ResourceManager::stopWatching() {
+#ifdef __linux__
+  if (watchFd_ >= 0) {
+    close(watchFd_);
+  }
+#endif
+  watchFd_ = -1;
+  watchedDirs_.clear();
+  changedFiles_.clear();
+}
+
+// Start watching a single directory
+void
+ResourceManager::addWatch(const std::string& dir) {
+#ifdef __linux__
+  const int wd = inotify_add_watch(watchFd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+  if (wd >= 0) {
+    watchedDirs_[wd] = dir;
+  }
+#endif
+}
+
+// Reload every resource that uses a file
+void
+ResourceManager::reloadFile(const std::string& fp) {
+  for (auto& entry : resources_) {
+    Resource& resource = entry.second;
+    if (normalisePath(resource.getFilepath()) == fp ||
+      normalisePath(resource.getDataFilepath()) == fp) {
+      sf::Clock clock;
+      if (resource.reload()) {
+        Console::log("Reloaded resource: %s (%.1fms)", 
+          entry.first.c_str(), clock.getElapsedTime().asSeconds() * 1000.f);
+      }
+    }
+  }
+}
+
+// Release unused textures and fonts until under the memory budget
+void
+ResourceManager::enforceMemoryBudget() {
+
+  // Total up what is loaded
+  residentMemory_ = 0;
+  for (const auto& entry : resources_) {
+    residentMemory_ += entry.second.getMemoryUsage();
+  }
+
+  // Easy out
+  if (memoryBudget_ == 0 || residentMemory_ <= memoryBudget_) { return; }
+
+  // Release the least recently used resources first
+  std::vector<Resource*> candidates;
+  for (auto& entry : resources_) {
+    if (entry.second.isEvictable()) {
+      candidates.push_back(&entry.second);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(), [](const Resource* a, const Resource* b) {
+    return a->getLastUsed() < b->getLastUsed();
+  });
+  for (Resource* resource : candidates) {
+    if (residentMemory_ <= memoryBudget_) { break; }
+    const std::size_t bytes = resource->getMemoryUsage();
+    resource->release();
+    residentMemory_ -= bytes;
+    evictedMemory_ += bytes;
+    ++evictionCount_;
+  }
+
+  // Warn when everything loaded is in use
+  static bool hasWarned = false;
+  if (residentMemory_ > memoryBudget_ && !hasWarned) {
+    Console::log("[Warning] Resources in use take %.1fMB, over the %.1fMB budget.",
+      residentMemory_ / 1048576.f, memoryBudget_ / 1048576.f);
+  }
+  hasWarned = residentMemory_ > memoryBudget_;
+}
+
+// Set the memory budget in megabytes
+void
+ResourceManager::setMemoryBudget(float megabytes) {
+  memoryBudget_ = static_cast<std::size_t>(std::max(0.f, megabytes) * 1048576.f);
+}
+
+// Get the memory budget in megabytes
+float
+ResourceManager::getMemoryBudget() {
+  return memoryBudget_ / 1048576.f;
+}
+
+// Get the memory used by loaded resources in megabytes
+float
+ResourceManager::getResidentMemory() {
+  return residentMemory_ / 1048576.f;
+}
+
+// Get the memory released by eviction in megabytes
+float
+ResourceManager::getEvictedMemory() {
+  return evictedMemory_ / 1048576.f;
+}
+
+// Show memory usage in the debug window
+void
+ResourceManager::showDebugInformation() {
+  ImGui::Text("Resource Memory: %.1f/%.1fMB", getResidentMemory(), getMemoryBudget());
+  ImGui::Text("Evicted: %.1fMB (%u resources)", getEvictedMemory(), evictionCount_);
+}
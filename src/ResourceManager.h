@@ -7,8 +7,13 @@
 #include <filesystem>
 #include <string>
 #include <map>
+#include <set>
+#include <vector>
+
+#include <SFML/System/Clock.hpp>
 
 #include "Resource.h"
+#include "StringTable.h"
 
 // Manage resource handles
 class ResourceManager {
@@ -23,17 +28,120 @@ class ResourceManager {
     // Get a resource by name
     static Resource& getResource(const std::string& name);
 
+    // Get a resource by interned name, avoids looking the name up
+    static Resource& getResource(NameID id);
+
+    // Get a typed handle to a resource, keeping it loaded while the handle exists
+    // Returns an empty handle if the resource doesn't exist or is another type
+    template <typename T>
+    static ResourceHandle<T> getHandle(const std::string& name);
+    template <typename T>
+    static ResourceHandle<T> getHandle(NameID id);
+
     // Delete all stored resources
     static void releaseResources();
 
+    // Record the name of every resource looked up into a set, null to stop recording
+    static void recordDependencies(std::set<NameID>* dependencies);
+
+    // Watch a folder and reload resources when their files change
+    static void watchResources(const std::string& dir = "Assets/");
+
+    // Collect changed files, called every frame
+    static void updateWatch();
+
+    // Check if changed files have settled and can be reloaded
+    static bool hasSettledChanges();
+
+    // Reload resources whose files have settled, which replaces them in place
+    static void reloadChanges();
+
+    // Stop watching for changes
+    static void stopWatching();
+
+    // Release unused textures and fonts until under the memory budget, called every frame
+    static void enforceMemoryBudget();
+
+    // Memory budget in megabytes, 0 for no budget
+    static void setMemoryBudget(float megabytes);
+    static float getMemoryBudget();
+
+    // Memory used by loaded resources in megabytes
+    static float getResidentMemory();
+
+    // Memory released by eviction in megabytes
+    static float getEvictedMemory();
+
+    // Show memory usage in the debug window
+    static void showDebugInformation();
+
   private:
 
     // Map of all resources
     static std::map<std::string, Resource> resources_;
 
+    // Resources indexed by the ID of their name, null if there isn't one
+    static std::vector<Resource*> resourceTable_;
+
+    // Where looked up resources are being recorded, if anywhere
+    static std::set<NameID>* recording_;
+
     // 'NULL' Resource
     static Resource nullResource_;
 
+    // Handle used to receive file changes, -1 when not watching
+    static int watchFd_;
+
+    // Directories being watched
+    static std::map<int, std::string> watchedDirs_;
+
+    // Files that changed and when they last changed
+    static std::map<std::string, float> changedFiles_;
+
+    // Measures time for debouncing changes
+    static sf::Clock watchClock_;
+
+    // Bytes that loaded resources may use before unused ones are released
+    static std::size_t memoryBudget_;
+
+    // Bytes used by loaded resources, updated every frame
+    static std::size_t residentMemory_;
+
+    // Bytes and amount of resources released to stay under budget
+    static std::size_t evictedMemory_;
+    static unsigned evictionCount_;
+
+    // Register resource type names to a Lua state
+    static void registerResourceConstants(sol::state_view lua);
+
+    // Evaluate a descriptor in this thread's own Lua state, safe to call from any thread
+    // Returns false if it has to be run in the main state instead
+    static bool evaluateDescriptor(const std::string& fp, ResourceDescriptor& descriptor);
+
+    // Start watching a single directory
+    static void addWatch(const std::string& dir);
+
+    // Reload every resource that uses a file
+    static void reloadFile(const std::string& fp);
+
 };
 
+// Get a typed handle to a resource
+template <typename T>
+ResourceHandle<T>
+ResourceManager::getHandle(const std::string& name) {
+  return getHandle<T>(StringTable::find(name));
+}
+
+// Get a typed handle to a resource by interned name
+template <typename T>
+ResourceHandle<T>
+ResourceManager::getHandle(NameID id) {
+  Resource& resource = getResource(id);
+  if (resource.getType() != ResourceTraits<T>::type) {
+    return ResourceHandle<T>();
+  }
+  return ResourceHandle<T>(&resource);
+}
+
 #endif
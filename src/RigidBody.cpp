@@ -6,9 +6,12 @@
 // Avoid cyclic dependancies
 #include "PhysicsSystem.h"
 #include "Combat.h"
+#include "Replay.h"
+#include "ScriptEvents.h"
 
 // Define statics
 b2World* RigidBody::worldToSpawnIn_ = nullptr;
+BodyPool* RigidBody::poolToSpawnIn_ = nullptr;
 b2BodyDef RigidBody::defaultBodyDefinition_ = b2BodyDef();
 
 // Make a box shape
@@ -42,7 +45,7 @@ RigidBody::LineShape(float x1, float y1, float x2, float y2) {
 
 // Enable use of this component when physics system is enabled
 void 
-RigidBody::registerRigidBodyType(sol::environment& env, b2World* world) {
+RigidBody::registerRigidBodyType(sol::environment& env, b2World* world, BodyPool* pool) {
 
   // Debug message
   Console::log("Enabling usage of RigidBody components..");
@@ -51,6 +54,7 @@ RigidBody::registerRigidBodyType(sol::environment& env, b2World* world) {
   // This takes away the responsibility of the programmer to
   // pass the world around
   worldToSpawnIn_ = world;
+  poolToSpawnIn_ = pool;
 
   // Register the RigidBody only if there's a 'world'
   if (worldToSpawnIn_ != nullptr) {
@@ -78,6 +82,7 @@ RigidBody::registerRigidBodyType(sol::environment& env, b2World* world) {
       "location", sol::property([](const RigidBody& self){return PhysicsSystem::convertToSF(self.body_->GetWorldCenter());}),
       // Basic functions
       "instantiate", &RigidBody::instantiateBody,
+      "instantiatePooled", &RigidBody::instantiatePooledBody,
       "addFixture", &RigidBody::addFixture,
       "makeGroundSensor", &RigidBody::makeGroundSensor,
       "warpTo", sol::overload(&RigidBody::warpTo, &RigidBody::warpToVec),
@@ -171,39 +176,37 @@ RigidBody::registerNonDependantTypes(sol::environment& env) {
 // Constructor
 RigidBody::RigidBody(ECS::Entity* e)
   : Component(e)
-  , physics_(worldToSpawnIn_)
-  , body_(physics_->CreateBody(&defaultBodyDefinition_))
+  , pool_(poolToSpawnIn_)
+  , body_(nullptr)
   , previousPosition_(b2Vec2(0.0f, 0.0f))
   , previousAngle_(0.0f) 
   , isOutOfSync_(true) 
   , underfootContacts_(0) {
   
   // Ensure this body contains the RigidBody
+  body_ = pool_->acquire(defaultBodyDefinition_, nullptr, archetype_);
   body_->SetUserData(this);
 }
 
 // Ensure that every RigidBody has its own b2Body during copy
 RigidBody::RigidBody(const RigidBody& other)
   : Component(other)
-  , physics_(other.worldToSpawnIn_)
-  , body_(physics_->CreateBody(&defaultBodyDefinition_))
+  , pool_(other.poolToSpawnIn_)
+  , body_(nullptr)
   , previousPosition_(other.previousPosition_)
   , previousAngle_(other.previousAngle_)
   , isOutOfSync_(other.isOutOfSync_)
   , underfootContacts_(other.underfootContacts_) {
 
   // Ensure this body contains the RigidBody
+  body_ = pool_->acquire(defaultBodyDefinition_, nullptr, archetype_);
   body_->SetUserData(this);
 }
 
-// Delete this RigidBody's b2Body
+// Hand this RigidBody's b2Body back to the pool
 RigidBody::~RigidBody() {
   if (body_ != nullptr) {
-    body_->SetUserData(nullptr);
-    b2World* world = body_->GetWorld();
-    if (world != nullptr) {
-      world->DestroyBody(body_);
-    }
+    pool_->release(body_, archetype_);
     body_ = nullptr;
   }
 }
@@ -212,14 +215,32 @@ RigidBody::~RigidBody() {
 void
 RigidBody::instantiateBody(const b2BodyDef& def) {
 
-  // If the body already exists, destroy it
+  // If the body already exists, hand it back
   if (body_ != nullptr) {
-   disposeList_.push_back(body_);
-   body_ = nullptr;
+    pool_->release(body_, archetype_);
+    body_ = nullptr;
   }
 
   // Create a new body out of the new definitions
-  body_ = physics_->CreateBody(&def);
+  body_ = pool_->acquire(def, nullptr, archetype_);
+  body_->SetUserData(this);
+
+  // Mark this RididBody as out of sync with it's transform
+  isOutOfSync_ = true;
+}
+
+// Recreate the b2Body with a single fixture, reusing an old one if possible
+void
+RigidBody::instantiatePooledBody(const b2BodyDef& def, const b2FixtureDef& fixture) {
+
+  // If the body already exists, hand it back
+  if (body_ != nullptr) {
+    pool_->release(body_, archetype_);
+    body_ = nullptr;
+  }
+
+  // Take a body with the fixture already attached
+  body_ = pool_->acquire(def, &fixture, archetype_);
   body_->SetUserData(this);
 
   // Mark this RididBody as out of sync with it's transform
@@ -230,6 +251,9 @@ RigidBody::instantiateBody(const b2BodyDef& def) {
 void
 RigidBody::addFixture(const b2FixtureDef& def) {
   body_->CreateFixture(&def);
+
+  // The body no longer matches what the pool expects
+  archetype_ = BodyArchetype();
 }
 
 // Check if this entity is on the ground
@@ -308,6 +332,7 @@ RigidBody::applyImpulseToCentre(float i, float j) {
 }
 void 
 RigidBody::applyImpulseToCentreVec(const sf::Vector2f& impulse) {
+  Replay::logImpulse(impulse, PhysicsSystem::convertToSF(body_->GetWorldCenter()));
   body_->ApplyLinearImpulse(PhysicsSystem::convertToB2(impulse), body_->GetWorldCenter(), true);
 }
 
@@ -318,6 +343,7 @@ RigidBody::applyImpulseRel(float i, float j, float x, float y) {
 }
 void
 RigidBody::applyImpulseRelVec(const sf::Vector2f& impulse, const sf::Vector2f& relPos) {
+  Replay::logImpulse(impulse, relPos);
   body_->ApplyLinearImpulse(PhysicsSystem::convertToB2(impulse), body_->GetWorldPoint(PhysicsSystem::convertToB2(relPos)), true);
 }
 
@@ -328,6 +354,7 @@ RigidBody::applyImpulse(float i, float j, float x, float y) {
 }
 void
 RigidBody::applyImpulseVec(const sf::Vector2f& impulse, const sf::Vector2f& location) {
+  Replay::logImpulse(impulse, location);
   body_->ApplyLinearImpulse(PhysicsSystem::convertToB2(impulse), PhysicsSystem::convertToB2(location), true);
 }
 
@@ -346,6 +373,12 @@ RigidBody::startContact(const FixtureType& type, RigidBody* other, double impact
     auto cb = owner_->get<Combat>();
     cb->dealImpactDamage(impact);
   }
+
+  // Let scripts know, the other body may be static scenery without an entity
+  auto* world = Game::getWorld();
+  if (world != nullptr) {
+    world->emit<ContactEvent>({owner_, other != nullptr ? other->owner_ : nullptr, impact});
+  }
 }
 // When contact ends
 void
@@ -371,4 +404,7 @@ RigidBody::makeGroundSensor() {
 
   // Ensure the sensor knows about this rigidbody
   groundSensor->SetUserData((void*)FixtureType::GroundSensor);
+
+  // The body no longer matches what the pool expects
+  archetype_ = BodyArchetype();
 }
@@ -7,6 +7,7 @@
 #include "Game.h"
 #include "Scripting.h"
 #include "ContactListener.h"
+#include "BodyPool.h"
 #include <Box2D/Box2D.h>
 #include <vector>
 
@@ -17,13 +18,16 @@ class RigidBody : Component{
     // Friend of the physics system
     friend class PhysicsSystem;
 
+    // Prefabs build bodies without going through Lua
+    friend class Prefab;
+
     // Make different shapes
     static b2PolygonShape BoxShape(float w, float h);
     static b2CircleShape CircleShape(float x, float y, float r);
     static b2EdgeShape LineShape(float x1, float y1, float x2, float y2);
 
     // Make this component scriptable
-    static void registerRigidBodyType(sol::environment& env, b2World* world);
+    static void registerRigidBodyType(sol::environment& env, b2World* world, BodyPool* pool);
     static void registerNonDependantTypes(sol::environment& env);
 
     // Constructor
@@ -38,6 +42,9 @@ class RigidBody : Component{
     // Create the b2Body out of a b2BodyDef
     void instantiateBody(const b2BodyDef& def);
 
+    // Create the b2Body and its only fixture, reusing a pooled body if possible
+    void instantiatePooledBody(const b2BodyDef& def, const b2FixtureDef& fixture);
+
     // Add a fixture to this body
     void addFixture(const b2FixtureDef& def);
 
@@ -89,6 +96,7 @@ class RigidBody : Component{
     // We have static operators so this operator must be defined
     void operator= (const RigidBody& other) { 
        body_ = other.body_;
+       archetype_ = other.archetype_;
        previousPosition_ = other.previousPosition_;
        previousAngle_ = other.previousAngle_;
        isOutOfSync_ = other.isOutOfSync_;
@@ -113,18 +121,21 @@ class RigidBody : Component{
 
     // The world of this object, not to be confused with the ECS world
     static b2World* worldToSpawnIn_;
-    b2World* const physics_;
+
+    // The pool to take bodies from and hand them back to
+    static BodyPool* poolToSpawnIn_;
+    BodyPool* const pool_;
 
     // The encapsulated body of this object
     b2Body* body_;
 
+    // What the body looks like, used to hand it back to the pool
+    BodyArchetype archetype_;
+
     // Manipulated by physics system
     b2Vec2 previousPosition_;
     float previousAngle_;
 
-    // List of b2Bodys to destroy
-    std::vector<b2Body*> disposeList_;
-
     // Marks whether this b2Body's position is out of sync with transform
     bool isOutOfSync_;
 
@@ -17,6 +17,7 @@
 #include "Movement.h"
 #include "Abilities.h"
 #include "Combat.h"
+#include "ScriptProfiler.h"
 
 // Register scene functionality to Lua
 void
@@ -28,7 +29,17 @@ Scene::registerSceneType() {
     "onHide", &Scene::onHide_,
     "onUpdate", &Scene::onUpdate_,
     "onWindowEvent", &Scene::onWindowEvent_,
-    "onQuit", &Scene::onQuit_
+    "onQuit", &Scene::onQuit_,
+    "onLoading", &Scene::onLoading_,
+    "budget", &Scene::budget_,
+    "resources", sol::property(
+      [](const Scene& self) { 
+        std::vector<std::string> names;
+        for (NameID id : self.dependencies_) { names.push_back(StringTable::getString(id)); }
+        return names; },
+      [](Scene& self, const sol::table& names) {
+        self.dependencies_.clear();
+        for (const auto& name : names) { self.dependencies_.insert(StringTable::fromLua(name.second)); } })
   );
 }
 
@@ -47,11 +58,15 @@ Scene::Scene(const Scene& other)
   , onHide_(other.onHide_)
   , onUpdate_(other.onUpdate_)
   , onWindowEvent_(other.onWindowEvent_)
-  , onQuit_(other.onQuit_) {
+  , onQuit_(other.onQuit_)
+  , onLoading_(other.onLoading_)
+  , budget_(other.budget_)
+  , dependencies_(other.dependencies_) {
 }
 
 // Destructor
 Scene::~Scene() {
+  events_.clear();
   world_->destroyWorld();
 }
 
@@ -61,6 +76,7 @@ Scene::begin() {
 
   // Try to call the begin function from this scene's lua
   if (onBegin_.valid()) {
+    ScriptWatchdog::Budget budget("Scene.onBegin", ScriptWatchdog::getLoadingLimits());
     auto attempt = onBegin_();
     if (!attempt.valid()) {
       sol::error err = attempt;
@@ -79,6 +95,8 @@ Scene::registerFunctions() {
   // Set up environment
   lua_ = sol::environment(Game::lua, sol::create, Game::lua.globals());
   Script::registerSceneFunctions(lua_, world_);
+  scheduler_.registerFunctions(lua_);
+  events_.registerFunctions(lua_, world_);
 
   // Expose the world in the scene
   Game::lua["World"] = lua_;
@@ -92,13 +110,16 @@ Scene::registerFunctions() {
 void
 Scene::showScene() {
 
-  // Begin the scene if it hasn't yet
+  // Begin the scene if it hasn't yet, remembering what it used so it can be prefetched next time
   if (!hasBegun_) {
+    ResourceManager::recordDependencies(&dependencies_);
     begin();
+    ResourceManager::recordDependencies(nullptr);
   }
 
   // Try to call the begin function from this scene's lua
   if (onShow_.valid()) {
+    ScriptWatchdog::Budget budget("Scene.onShow", ScriptWatchdog::getLoadingLimits());
     auto attempt = onShow_();
     if (!attempt.valid()) {
       sol::error err = attempt;
@@ -107,10 +128,69 @@ Scene::showScene() {
   }
 }
 
+// Check whether the resources this scene uses are known
+bool
+Scene::hasDependencies() const {
+  return !dependencies_.empty();
+}
+
+// Start loading the resources this scene uses in the background
+void
+Scene::prefetch() {
+  releasePrefetched();
+  for (NameID id : dependencies_) {
+    Resource& resource = ResourceManager::getResource(id);
+    if (resource.getType() == Resource::Type::UNKNOWN) { continue; }
+    prefetched_.emplace_back(&resource);
+    loading_.push_back(resource.getAsync());
+  }
+}
+
+// Wait for prefetched resources to finish loading
+void
+Scene::waitForResources() {
+  for (const auto& future : loading_) {
+    future.wait();
+  }
+}
+
+// Get how much of the prefetched resources have loaded
+float
+Scene::getLoadingProgress() const {
+  if (loading_.empty()) { return 1.f; }
+  std::size_t ready = 0;
+  for (const auto& future : loading_) {
+    ready += future.isReady();
+  }
+  return static_cast<float>(ready) / loading_.size();
+}
+
+// Tell the scene's Lua how loading is going
+void
+Scene::reportLoadingProgress(float progress) {
+  if (onLoading_.valid()) {
+    ScriptWatchdog::Budget budget("Scene.onLoading", budget_);
+    auto attempt = onLoading_(progress);
+    if (!attempt.valid()) {
+      sol::error err = attempt;
+      Console::log("[Error] in Scene.onLoading():\n> %s", err.what());
+    }
+  }
+}
+
+// Let go of prefetched resources so they can be evicted
+void
+Scene::releasePrefetched() {
+  prefetched_.clear();
+  loading_.clear();
+}
+
 // When the screen is hidden
 void
 Scene::hideScene() {
+  releasePrefetched();
   if (onHide_.valid()) {
+    ScriptWatchdog::Budget budget("Scene.onHide", ScriptWatchdog::getLoadingLimits());
     auto attempt = onHide_();
     if (!attempt.valid()) {
       sol::error err = attempt;
@@ -123,8 +203,16 @@ Scene::hideScene() {
 void
 Scene::update(const sf::Time& dt) {
 
+  // Resume coroutines that are due
+  {
+    ScriptProfiler::Scope scope("Scheduler::update");
+    scheduler_.update(dt);
+  }
+
   // Call scene's update script
   if (onUpdate_.valid()) {
+    ScriptProfiler::Scope scope("Scene::update");
+    ScriptWatchdog::Budget budget("Scene.onUpdate", budget_);
     auto attempt = onUpdate_(dt);
     if (!attempt.valid()) {
       sol::error err = attempt;
@@ -132,6 +220,9 @@ Scene::update(const sf::Time& dt) {
     }
   }
 
+  // Hand over events from the scripts, systems hand over theirs as they update
+  events_.dispatch();
+
   // Update the ECS
   world_->update(dt);
 }
@@ -174,6 +265,7 @@ Scene::handleEvent(const sf::Event& event) {
 
   // Call scene's input script
   if (onWindowEvent_.valid()) {
+    ScriptWatchdog::Budget budget("Scene.onWindowEvent", budget_);
     auto attempt = onWindowEvent_(event);
     if (!attempt.valid()) {
       sol::error err = attempt;
@@ -187,6 +279,7 @@ void
 Scene::quit() {
   bool quitAnyway = !onQuit_.valid();
   if (!quitAnyway) {
+    ScriptWatchdog::Budget budget("Scene.onQuit", ScriptWatchdog::getLoadingLimits());
     auto attempt = onQuit_();
     if (!attempt.valid()) {
       quitAnyway = true;
@@ -230,6 +323,8 @@ Scene::addDebugInfoToDefault() {
   // Add to default window
   ImGui::Begin("Debug");
   ImGui::Text("Entities in system: %lu", world_->getCount());
+  ImGui::Text("Coroutines: %lu", scheduler_.getCount());
+  ImGui::Text("Event subscriptions: %lu", events_.getCount());
   ImGui::End();
 
   // Show the entity viewer
@@ -7,10 +7,15 @@
 #include <string>
 #include <memory>
 #include <map>
+#include <set>
+#include <vector>
 
 #include "Game.h"
 #include "Scripting.h"
 #include "PhysicsSystem.h"
+#include "Scheduler.h"
+#include "ScriptEvents.h"
+#include "ScriptWatchdog.h"
 
 // Represents it's own world of objects
 class Scene {
@@ -47,6 +52,24 @@ class Scene {
     // Add functionality to the default window
     void addDebugInfoToDefault();
 
+    // Check whether the resources this scene uses are known
+    bool hasDependencies() const;
+
+    // Start loading the resources this scene uses in the background
+    void prefetch();
+
+    // Wait for prefetched resources to finish loading
+    void waitForResources();
+
+    // Get how much of the prefetched resources have loaded, from 0 to 1
+    float getLoadingProgress() const;
+
+    // Tell the scene's Lua how loading is going
+    void reportLoadingProgress(float progress);
+
+    // Let go of prefetched resources so they can be evicted
+    void releasePrefetched();
+
   private:
 
     // If the scene has begun
@@ -65,6 +88,25 @@ class Scene {
     sol::protected_function onUpdate_;
     sol::protected_function onWindowEvent_;
     sol::protected_function onQuit_;
+    sol::protected_function onLoading_;
+
+    // How long onUpdate can run each frame
+    ScriptWatchdog::Limits budget_;
+
+    // Resources this scene uses, declared by its script or recorded when it begins
+    std::set<NameID> dependencies_;
+
+    // Keeps prefetched resources loaded while the scene may use them
+    std::vector<ResourceHandle<void>> prefetched_;
+
+    // Prefetched resources that may still be loading
+    std::vector<ResourceFuture> loading_;
+
+    // Coroutines started by this scene's scripts
+    Scheduler scheduler_;
+
+    // Engine events this scene's scripts subscribed to
+    ScriptEvents events_;
 
     // Ordered collection of things to render
     std::multimap<int, const sf::Drawable*> drawList_;
@@ -0,0 +1,285 @@
+// Scheduler.cpp
+// Resumes Lua coroutines once what they are waiting for has happened
+
+#include "Scheduler.h"
+
+#include <algorithm>
+
+// Avoid cyclic dependencies
+#include "Game.h"
+#include "ScriptProfiler.h"
+#include "ScriptWatchdog.h"
+
+// Register wait, waitFrames and waitUntil, which yield the running coroutine
+// They are global so spells, which don't run in a scene's environment, can use them
+void
+Scheduler::registerWaitFunctions() {
+  Game::lua.set("wait", static_cast<lua_CFunction>(&Scheduler::wait));
+  Game::lua.set("waitFrames", static_cast<lua_CFunction>(&Scheduler::waitFrames));
+  Game::lua.set("waitUntil", static_cast<lua_CFunction>(&Scheduler::waitUntil));
+
+  // Add to auto complete
+  Console::addCommand("wait");
+  Console::addCommand("waitFrames");
+  Console::addCommand("waitUntil");
+}
+
+// Constructor
+Scheduler::Scheduler()
+  : time_(0.0)
+  , frame_(0)
+  , nextId_(1) {
+}
+
+// Destructor, stops every coroutine
+Scheduler::~Scheduler() {
+  clear();
+}
+
+// Let a scene's scripts start and stop coroutines run by this scheduler
+void
+Scheduler::registerFunctions(sol::environment& env) {
+
+  // Starting needs this scheduler, so it's a closure over it
+  lua_State* L = Game::lua.lua_state();
+  env.push();
+  lua_pushlightuserdata(L, this);
+  lua_pushcclosure(L, &Scheduler::startCoroutine, 1);
+  lua_setfield(L, -2, "startCoroutine");
+  lua_pop(L, 1);
+  env.set_function("stopCoroutine", [this](unsigned id) { stop(id); });
+
+  // Add to auto complete
+  Console::addCommand("World.startCoroutine");
+  Console::addCommand("World.stopCoroutine");
+}
+
+// Resume the coroutines that are due
+void
+Scheduler::update(const sf::Time& dt) {
+  time_ += dt.asSeconds();
+  ++frame_;
+
+  // Collect what's due before resuming, so coroutines that wait again aren't resumed twice
+  due_.clear();
+  while (!frameTimers_.empty() && frameTimers_.top().first <= frame_) {
+    due_.push_back(frameTimers_.top().second);
+    frameTimers_.pop();
+  }
+  while (!timers_.empty() && timers_.top().first <= time_) {
+    due_.push_back(timers_.top().second);
+    timers_.pop();
+  }
+
+  // Conditions are the only waits that cost anything every frame
+  for (std::size_t i = 0; i < conditions_.size();) {
+    const unsigned id = conditions_[i];
+    auto it = routines_.find(id);
+    if (it == routines_.end()) {
+      conditions_[i] = conditions_.back();
+      conditions_.pop_back();
+      continue;
+    }
+    sol::protected_function condition = it->second.condition;
+    ScriptWatchdog::Budget budget("waitUntil condition");
+    auto attempt = condition();
+    if (attempt.valid() && !attempt.get<bool>()) {
+      ++i;
+      continue;
+    }
+
+    // Failed conditions stop the coroutine, met ones resume it
+    // The condition may have started coroutines, so look this one up again
+    conditions_[i] = conditions_.back();
+    conditions_.pop_back();
+    if (!attempt.valid()) {
+      sol::error err = attempt;
+      Console::log("[Error] in waitUntil condition:\n> %s", err.what());
+      stop(id);
+      continue;
+    }
+    it = routines_.find(id);
+    if (it != routines_.end()) {
+      it->second.condition = sol::lua_nil;
+      due_.push_back(id);
+    }
+  }
+
+  // Resume everything that's due, coroutines that were stopped are skipped
+  const std::vector<unsigned> due = due_;
+  for (unsigned id : due) {
+    resume(id, 0);
+  }
+}
+
+// Stop a coroutine
+void
+Scheduler::stop(unsigned id) {
+  auto it = routines_.find(id);
+  if (it == routines_.end()) { return; }
+
+  // A coroutine stopping itself is let go once it yields
+  if (it->second.isRunning) {
+    it->second.isStopped = true;
+  }
+  else {
+    release(id);
+  }
+}
+
+// Stop every coroutine
+void
+Scheduler::clear() {
+  lua_State* L = Game::lua.lua_state();
+  for (auto& routine : routines_) {
+    ScriptProfiler::releaseThread(routine.second.thread);
+    luaL_unref(L, LUA_REGISTRYINDEX, routine.second.ref);
+  }
+  routines_.clear();
+  timers_ = TimerHeap<double>();
+  frameTimers_ = TimerHeap<unsigned long>();
+  conditions_.clear();
+  due_.clear();
+}
+
+// Get the amount of running coroutines
+std::size_t
+Scheduler::getCount() const {
+  return routines_.size();
+}
+
+// Start a coroutine running a function, with any other arguments passed to it
+int
+Scheduler::startCoroutine(lua_State* L) {
+  auto* self = static_cast<Scheduler*>(lua_touserdata(L, lua_upvalueindex(1)));
+  luaL_checktype(L, 1, LUA_TFUNCTION);
+
+  // Move the function and its arguments to a new thread, kept alive by the registry
+  const int args = lua_gettop(L);
+  lua_State* thread = lua_newthread(L);
+  lua_insert(L, 1);
+  lua_xmove(L, thread, args);
+  const int ref = luaL_ref(L, LUA_REGISTRYINDEX);
+  const unsigned id = self->nextId_++;
+  self->routines_[id] = Routine{ thread, ref, false, false, sol::protected_function() };
+
+  // Run it until it first waits
+  self->resume(id, args - 1);
+  lua_pushinteger(L, id);
+  return 1;
+}
+
+// Wait for some seconds
+int
+Scheduler::wait(lua_State* L) {
+  luaL_optnumber(L, 1, 0.0);
+  return yieldFor(L, Time);
+}
+
+// Wait for some frames, one by default
+int
+Scheduler::waitFrames(lua_State* L) {
+  luaL_optinteger(L, 1, 1);
+  return yieldFor(L, Frames);
+}
+
+// Wait until a function returns true
+int
+Scheduler::waitUntil(lua_State* L) {
+  luaL_checktype(L, 1, LUA_TFUNCTION);
+  return yieldFor(L, Condition);
+}
+
+// Yield the running coroutine to the scheduler, with what it's waiting for
+int
+Scheduler::yieldFor(lua_State* L, Wait wait) {
+
+  // The main thread can't yield, which is where the console and callbacks run
+  if (lua_pushthread(L)) {
+    return luaL_error(L, "can only wait inside a coroutine, start one with World.startCoroutine");
+  }
+  lua_pop(L, 1);
+
+  // Yield what to wait for and how long
+  lua_settop(L, 1);
+  lua_pushinteger(L, wait);
+  lua_insert(L, 1);
+  return lua_yield(L, 2);
+}
+
+// Resume a coroutine, then schedule it or let it go
+void
+Scheduler::resume(unsigned id, int args) {
+  auto it = routines_.find(id);
+  if (it == routines_.end()) { return; }
+  lua_State* thread = it->second.thread;
+  it->second.isRunning = true;
+  int status;
+  int results;
+  {
+    // Coroutines over budget yield where Lua allows it, and carry on next frame
+    // Sol's compatibility layer gives Lua 5.1 and LuaJIT the three argument lua_resume
+    ScriptWatchdog::Budget budget("Coroutine", ScriptWatchdog::Limits(), thread);
+#if LUA_VERSION_NUM >= 504
+    status = lua_resume(thread, nullptr, args, &results);
+#else
+    status = lua_resume(thread, nullptr, args);
+    results = lua_gettop(thread);
+#endif
+  }
+
+  // Coroutines started while this one ran may have moved it
+  it = routines_.find(id);
+  it->second.isRunning = false;
+  if (status == LUA_YIELD && !it->second.isStopped) {
+    schedule(id, thread, results);
+    return;
+  }
+
+  // Finished, failed or stopped itself
+  if (status != LUA_YIELD && status != 0) {
+    const char* error = lua_tostring(thread, -1);
+    Console::log("[Error] in coroutine:\n> %s", error != nullptr ? error : "unknown error");
+  }
+  release(id);
+}
+
+// Schedule a coroutine by what it yielded, nothing means it was put off until the next frame
+// Only the yielded values are removed, Lua 5.4 keeps a hook's yielding function below them
+void
+Scheduler::schedule(unsigned id, lua_State* thread, int results) {
+  const int top = lua_gettop(thread);
+  if (results == 0) {
+    frameTimers_.push(std::make_pair(frame_ + 1, id));
+    return;
+  }
+  const int wait = results >= 2 ? (int)lua_tointeger(thread, top - 1) : Frames;
+  switch (wait) {
+    case Time:
+      timers_.push(std::make_pair(time_ + lua_tonumber(thread, top), id));
+      break;
+    case Condition: {
+      // The condition is called from the main thread, so it's referenced from there
+      lua_State* L = Game::lua.lua_state();
+      lua_xmove(thread, L, 1);
+      routines_[id].condition = sol::protected_function(L, -1);
+      lua_pop(L, 1);
+      conditions_.push_back(id);
+      break;
+    }
+    default:
+      frameTimers_.push(std::make_pair(frame_ + std::max(1, (int)lua_tointeger(thread, top)), id));
+      break;
+  }
+  lua_settop(thread, top - results);
+}
+
+// Let go of a coroutine
+void
+Scheduler::release(unsigned id) {
+  auto it = routines_.find(id);
+  if (it == routines_.end()) { return; }
+  ScriptProfiler::releaseThread(it->second.thread);
+  luaL_unref(Game::lua.lua_state(), LUA_REGISTRYINDEX, it->second.ref);
+  routines_.erase(it);
+}
@@ -0,0 +1,100 @@
+// Scheduler.h
+// Resumes Lua coroutines once what they are waiting for has happened
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <SFML/System.hpp>
+
+#include "Sol.h"
+
+// Runs a scene's coroutines, only those that are due are resumed each frame
+class Scheduler {
+  public:
+
+    // Register wait, waitFrames and waitUntil, which yield the running coroutine
+    static void registerWaitFunctions();
+
+    // Constructor
+    Scheduler();
+
+    // Destructor, stops every coroutine
+    ~Scheduler();
+
+    // Let a scene's scripts start and stop coroutines run by this scheduler
+    void registerFunctions(sol::environment& env);
+
+    // Resume the coroutines that are due
+    void update(const sf::Time& dt);
+
+    // Stop a coroutine
+    void stop(unsigned id);
+
+    // Stop every coroutine
+    void clear();
+
+    // Get the amount of running coroutines
+    std::size_t getCount() const;
+
+  private:
+
+    // What a coroutine is waiting for, passed to the scheduler when it yields
+    enum Wait { Time, Frames, Condition };
+
+    // A running coroutine
+    struct Routine {
+      lua_State* thread;
+      int ref;
+      bool isRunning;
+      bool isStopped;
+      sol::protected_function condition;
+    };
+
+    // Lua functions, written against the C API as they manage the stack and yield
+    static int startCoroutine(lua_State* L);
+    static int wait(lua_State* L);
+    static int waitFrames(lua_State* L);
+    static int waitUntil(lua_State* L);
+
+    // Yield the running coroutine to the scheduler, with what it's waiting for
+    static int yieldFor(lua_State* L, Wait wait);
+
+    // Resume a coroutine, then schedule it or let it go
+    void resume(unsigned id, int args);
+
+    // Schedule a coroutine by what it yielded
+    void schedule(unsigned id, lua_State* thread, int results);
+
+    // Let go of a coroutine
+    void release(unsigned id);
+
+    // Running coroutines by ID
+    std::unordered_map<unsigned, Routine> routines_;
+
+    // Coroutines waiting for a time or frame, soonest first
+    template <typename T>
+    using TimerHeap = std::priority_queue<std::pair<T, unsigned>, std::vector<std::pair<T, unsigned>>, std::greater<std::pair<T, unsigned>>>;
+    TimerHeap<double> timers_;
+    TimerHeap<unsigned long> frameTimers_;
+
+    // Coroutines waiting for a condition, which is checked every frame
+    std::vector<unsigned> conditions_;
+
+    // Coroutines to resume this frame
+    std::vector<unsigned> due_;
+
+    // Time and frames the scheduler has run for
+    double time_;
+    unsigned long frame_;
+
+    // ID for the next coroutine, 0 is never used
+    unsigned nextId_;
+};
+
+#endif
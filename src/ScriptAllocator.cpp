@@ -0,0 +1,175 @@
+// ScriptAllocator.cpp
+// Size-class pools for Lua's small allocations, so they don't fragment the process heap
+
+#include "ScriptAllocator.h"
+
+#include <cstdlib>
+#include <cstring>
+
+// Avoid cyclic dependencies
+#include "Game.h"
+
+// Bytes each pool takes from the heap at once
+static const std::size_t chunkSize = 64 * 1024;
+
+// Initialise static members
+void* ScriptAllocator::freeLists_[classCount] = {};
+char* ScriptAllocator::chunkNext_[classCount] = {};
+char* ScriptAllocator::chunkEnd_[classCount] = {};
+std::size_t ScriptAllocator::usedMemory_ = 0;
+std::size_t ScriptAllocator::pooledMemory_ = 0;
+unsigned ScriptAllocator::frameAllocations_ = 0;
+unsigned ScriptAllocator::frameLargeAllocations_ = 0;
+std::size_t ScriptAllocator::frameBytes_ = 0;
+RollingHistory ScriptAllocator::allocations_;
+RollingHistory ScriptAllocator::largeAllocations_;
+RollingHistory ScriptAllocator::kilobytes_;
+
+// Allocator given to lua_newstate, Lua tells us the old size of every block
+void*
+ScriptAllocator::allocate(void* ud, void* ptr, std::size_t osize, std::size_t nsize) {
+
+  // Without a block, the old size is the type of object being made
+  if (ptr == nullptr) {
+    osize = 0;
+  }
+
+  // Free
+  if (nsize == 0) {
+    if (ptr != nullptr) {
+      const int sizeClass = getSizeClass(osize);
+      if (sizeClass >= 0) { releaseBlock(ptr, sizeClass); }
+      else { std::free(ptr); }
+      usedMemory_ -= osize;
+    }
+    return nullptr;
+  }
+
+  // Blocks in the same size class, or both on the heap, can be resized in place
+  const int oldClass = ptr != nullptr ? getSizeClass(osize) : -2;
+  const int newClass = getSizeClass(nsize);
+  void* block;
+  if (oldClass == newClass && newClass >= 0) {
+    block = ptr;
+  }
+  else if (oldClass == -1 && newClass == -1) {
+    block = std::realloc(ptr, nsize);
+    ++frameLargeAllocations_;
+  }
+
+  // Otherwise move the block to where its new size belongs
+  else {
+    if (newClass >= 0) {
+      block = allocateBlock(newClass);
+    }
+    else {
+      block = std::malloc(nsize);
+      ++frameLargeAllocations_;
+    }
+
+    // Lua expects shrinking to succeed, the old block is big enough to keep
+    // It is later freed as the smaller size, which leaves it in a smaller pool
+    if (block == nullptr) {
+      if (ptr != nullptr && nsize <= osize) {
+        usedMemory_ -= osize - nsize;
+        return ptr;
+      }
+      return nullptr;
+    }
+    if (ptr != nullptr) {
+      std::memcpy(block, ptr, std::min(osize, nsize));
+      if (oldClass >= 0) { releaseBlock(ptr, oldClass); }
+      else { std::free(ptr); }
+    }
+  }
+  if (block == nullptr) {
+    return nullptr;
+  }
+
+  // Count what changed
+  ++frameAllocations_;
+  if (nsize > osize) {
+    frameBytes_ += nsize - osize;
+  }
+  usedMemory_ += nsize;
+  usedMemory_ -= osize;
+  return block;
+}
+
+// Record the frame's allocations and start counting the next frame
+void
+ScriptAllocator::endFrame() {
+  allocations_.push(frameAllocations_);
+  largeAllocations_.push(frameLargeAllocations_);
+  kilobytes_.push(frameBytes_ / 1024.f);
+  frameAllocations_ = 0;
+  frameLargeAllocations_ = 0;
+  frameBytes_ = 0;
+}
+
+// Get the amount of allocations so far this frame
+unsigned
+ScriptAllocator::getFrameAllocations() {
+  return frameAllocations_;
+}
+
+// Get the bytes Lua is using
+std::size_t
+ScriptAllocator::getUsedMemory() {
+  return usedMemory_;
+}
+
+// Get the bytes reserved by pools
+std::size_t
+ScriptAllocator::getPooledMemory() {
+  return pooledMemory_;
+}
+
+// Show allocator information in the debug window
+void
+ScriptAllocator::showDebugInformation() {
+#if defined(SOL_LUAJIT) && SOL_LUAJIT
+  ImGui::Text("Lua Allocator: LuaJIT's own");
+#else
+  ImGui::Text("Lua Pools: %.1fMB reserved, %.1fMB in use",
+    pooledMemory_ / 1048576.f, usedMemory_ / 1048576.f);
+  allocations_.plotHistogram("Lua allocs");
+  largeAllocations_.plotHistogram("Lua heap allocs");
+  kilobytes_.plotLines("Lua KB/frame", "%.1f");
+#endif
+}
+
+// Get a block from a size class
+void*
+ScriptAllocator::allocateBlock(int sizeClass) {
+
+  // Reuse a freed block
+  void* block = freeLists_[sizeClass];
+  if (block != nullptr) {
+    freeLists_[sizeClass] = *static_cast<void**>(block);
+    return block;
+  }
+
+  // Take a new chunk from the heap when the current one is used up
+  // Chunks are kept for as long as the game runs, as Lua is closed at exit
+  const std::size_t blockSize = (sizeClass + 1) * 16;
+  if (chunkNext_[sizeClass] == nullptr || chunkNext_[sizeClass] + blockSize > chunkEnd_[sizeClass]) {
+    char* chunk = static_cast<char*>(std::malloc(chunkSize));
+    if (chunk == nullptr) {
+      return nullptr;
+    }
+    chunkNext_[sizeClass] = chunk;
+    chunkEnd_[sizeClass] = chunk + chunkSize;
+    pooledMemory_ += chunkSize;
+  }
+  block = chunkNext_[sizeClass];
+  chunkNext_[sizeClass] += blockSize;
+  return block;
+}
+
+// Return a block to its size class
+void
+ScriptAllocator::releaseBlock(void* block, int sizeClass) {
+  *static_cast<void**>(block) = freeLists_[sizeClass];
+  freeLists_[sizeClass] = block;
+}
@@ -0,0 +1,74 @@
+// ScriptAllocator.h
+// Size-class pools for Lua's small allocations, so they don't fragment the process heap
+
+#ifndef SCRIPTALLOCATOR_H
+#define SCRIPTALLOCATOR_H
+
+#include <cstddef>
+
+#include "Common.h"
+
+// Static class providing a lua_Alloc that serves small blocks from pools
+// Only the main Lua state uses it, so it isn't safe to share between threads
+// @NOTE: Allocating only touches plain data, so Lua can start before static constructors run
+class ScriptAllocator {
+  public:
+
+    // Amount of size classes, each 16 bytes larger than the last
+    static const int classCount = 16;
+
+    // Largest block served from a pool, larger ones go to the heap
+    static const std::size_t largestBlock = classCount * 16;
+
+    // Allocator given to lua_newstate, Lua tells us the old size of every block
+    static void* allocate(void* ud, void* ptr, std::size_t osize, std::size_t nsize);
+
+    // Record the frame's allocations and start counting the next frame
+    static void endFrame();
+
+    // Get the amount of allocations so far this frame
+    static unsigned getFrameAllocations();
+
+    // Get the bytes Lua is using, and the bytes reserved by pools
+    static std::size_t getUsedMemory();
+    static std::size_t getPooledMemory();
+
+    // Show allocator information in the debug window
+    static void showDebugInformation();
+
+  private:
+
+    // Get a block from a size class
+    static void* allocateBlock(int sizeClass);
+
+    // Return a block to its size class
+    static void releaseBlock(void* block, int sizeClass);
+
+    // Get the size class of a block size, or -1 if it's too large for a pool
+    static int getSizeClass(std::size_t size) {
+      return size <= largestBlock ? (size == 0 ? 0 : int((size - 1) / 16)) : -1;
+    }
+
+    // Free blocks of each size class, linked through their first bytes
+    static void* freeLists_[classCount];
+
+    // Unused space at the end of each class's newest chunk
+    static char* chunkNext_[classCount];
+    static char* chunkEnd_[classCount];
+
+    // Bytes Lua is using and bytes reserved by pool chunks
+    static std::size_t usedMemory_;
+    static std::size_t pooledMemory_;
+
+    // Counts for the current frame
+    static unsigned frameAllocations_;
+    static unsigned frameLargeAllocations_;
+    static std::size_t frameBytes_;
+
+    // Counts of previous frames
+    static RollingHistory allocations_;
+    static RollingHistory largeAllocations_;
+    static RollingHistory kilobytes_;
+};
+
+#endif
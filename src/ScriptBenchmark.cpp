@@ -0,0 +1,92 @@
+// ScriptBenchmark.cpp
+// Measures how long gameplay scripts take each frame, to compare Lua builds
+
+#include "ScriptBenchmark.h"
+
+#include <algorithm>
+#include <vector>
+
+// Avoid cyclic dependencies
+#include "Game.h"
+#include "Scripting.h"
+#include "ScriptCache.h"
+#include "ScriptAllocator.h"
+
+// Run a benchmark script for some frames and report the cost of each frame
+bool
+ScriptBenchmark::run(const std::string& fp, unsigned frames) {
+
+  // Scripts get the same functions as they do in game, but no window or resources
+  Script::startLua();
+  ECS::World* world = ECS::World::createWorld();
+  sol::environment env(Game::lua, sol::create, Game::lua.globals());
+  Script::registerSceneFunctions(env, world);
+  Game::lua["World"] = env;
+
+  // Run the setup and get the function to call every frame
+  sol::protected_function chunk;
+  std::string error;
+  if (!ScriptCache::load(Game::lua, fp, chunk, error)) {
+    Console::log("[Error] in %s:\n> %s", fp.c_str(), error.c_str());
+    world->destroyWorld();
+    return false;
+  }
+  auto attempt = chunk();
+  if (!attempt.valid() || attempt.get_type() != sol::type::function) {
+    if (!attempt.valid()) {
+      sol::error err = attempt;
+      Console::log("[Error] in %s:\n> %s", fp.c_str(), err.what());
+    }
+    else {
+      Console::log("[Error] %s must return a function to call every frame.", fp.c_str());
+    }
+    world->destroyWorld();
+    return false;
+  }
+  sol::protected_function update = attempt;
+
+  // Call the script every frame at a fixed rate so runs are comparable
+  const sf::Time dt = sf::seconds(1.f / 60.f);
+  std::vector<float> times;
+  times.reserve(frames);
+  unsigned long allocations = 0;
+  ScriptAllocator::endFrame();
+  bool success = true;
+  for (unsigned i = 0; i < frames && success; ++i) {
+    sf::Clock clock;
+    auto result = update(dt);
+    times.push_back(clock.getElapsedTime().asSeconds() * 1000.f);
+    allocations += ScriptAllocator::getFrameAllocations();
+    ScriptAllocator::endFrame();
+    if (!result.valid()) {
+      sol::error err = result;
+      Console::log("[Error] in %s on frame %u:\n> %s", fp.c_str(), i, err.what());
+      success = false;
+    }
+  }
+
+  // Report
+  if (!times.empty()) {
+    float total = 0.f;
+    for (float time : times) { total += time; }
+    std::vector<float> sorted = times;
+    std::sort(sorted.begin(), sorted.end());
+    const float percentile = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+#if defined(SOL_LUAJIT) && SOL_LUAJIT
+    const char* backend = LUAJIT_VERSION;
+#else
+    const char* backend = LUA_RELEASE;
+#endif
+    Console::log("%s: %lu frames, %.3fms average, %.3fms minimum, %.3fms 99th percentile, %.3fms maximum per frame.",
+      backend, times.size(), total / times.size(), sorted.front(), percentile, sorted.back());
+#if !defined(SOL_LUAJIT) || !SOL_LUAJIT
+    Console::log("%.1f Lua allocations per frame.", float(allocations) / times.size());
+#endif
+  }
+
+  // Clean up
+  Game::lua["World"] = sol::lua_nil;
+  env = sol::environment();
+  world->destroyWorld();
+  return success;
+}
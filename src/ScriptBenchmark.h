@@ -0,0 +1,18 @@
+// ScriptBenchmark.h
+// Measures how long gameplay scripts take each frame, to compare Lua builds
+
+#ifndef SCRIPTBENCHMARK_H
+#define SCRIPTBENCHMARK_H
+
+#include <string>
+
+// Static class that runs a benchmark script without a window
+class ScriptBenchmark {
+  public:
+
+    // Run a benchmark script for some frames and report the cost of each frame
+    // The script sets up a world and returns a function to call every frame
+    static bool run(const std::string& fp, unsigned frames);
+};
+
+#endif
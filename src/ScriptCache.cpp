@@ -0,0 +1,183 @@
+// ScriptCache.cpp
+// Keeps compiled Lua bytecode on disk so scripts aren't parsed every launch
+
+#include "ScriptCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+// Avoid cyclic dependencies
+#include "AssetPack.h"
+#include "Console.h"
+
+// Initialise static members
+// LuaJIT bytecode is different, so it's kept apart
+#if defined(SOL_LUAJIT) && SOL_LUAJIT
+const std::string ScriptCache::directory_ = ".cache/scripts-luajit";
+#else
+const std::string ScriptCache::directory_ = ".cache/scripts";
+#endif
+bool ScriptCache::isEnabled_ = true;
+std::atomic<unsigned> ScriptCache::hits_(0);
+std::atomic<unsigned> ScriptCache::misses_(0);
+
+// Identifies cache files
+static const char cacheMagic[4] = { 'R', 'L', 'B', 'C' };
+static const sf::Uint32 cacheVersion = 1;
+
+// What a cache file knows about the script it was made from
+struct CacheHeader {
+  char magic[4];
+  sf::Uint32 version;
+  sf::Int64 modified;
+  sf::Uint64 size;
+  sf::Uint64 hash;
+};
+
+// Load a script without running it, using cached bytecode when it's fresh
+bool
+ScriptCache::load(sol::state_view lua, const std::string& fp,
+  sol::protected_function& chunk, std::string& error) {
+
+  // Chunks are named like script_file does so errors look the same
+  const std::string chunkName = "@" + fp;
+
+  // Turn a loaded chunk into a function or an error
+  auto finish = [&chunk, &error](sol::load_result& loaded) {
+    if (!loaded.valid()) {
+      sol::error err = loaded;
+      error = err.what();
+      return false;
+    }
+    chunk = loaded.get<sol::protected_function>();
+    return true;
+  };
+
+  // Packed scripts are already compiled
+  const AssetPack::Entry* packed = AssetPack::find(fp);
+  if (packed != nullptr && packed->kind == AssetPack::Kind::SCRIPT) {
+    sol::load_result loaded = lua.load_buffer(packed->data, packed->size, chunkName, sol::load_mode::binary);
+    return finish(loaded);
+  }
+
+  // Without the cache, load the file as normal
+  if (!isEnabled_) {
+    sol::load_result loaded = lua.load_file(fp);
+    return finish(loaded);
+  }
+
+  // Find out about the script
+  std::error_code ec;
+  const auto modified = std::filesystem::last_write_time(fp, ec);
+  const auto size = std::filesystem::file_size(fp, ec);
+  if (ec) {
+    error = "cannot open " + fp;
+    return false;
+  }
+  CacheHeader current = {};
+  std::copy(cacheMagic, cacheMagic + 4, current.magic);
+  current.version = cacheVersion;
+  current.modified = modified.time_since_epoch().count();
+  current.size = size;
+
+  // Cache files are named by a hash of the script's path
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.luac", static_cast<unsigned long long>(hash(fp.data(), fp.size())));
+  const std::filesystem::path cachePath = std::filesystem::path(directory_) / name;
+
+  // Read the cached header and bytecode
+  CacheHeader cached = {};
+  std::string bytecode;
+  std::ifstream cacheInput(cachePath, std::ios::binary);
+  if (cacheInput.read(reinterpret_cast<char*>(&cached), sizeof(cached)) &&
+    std::equal(cacheMagic, cacheMagic + 4, cached.magic) && cached.version == cacheVersion) {
+    bytecode.assign(std::istreambuf_iterator<char>(cacheInput), std::istreambuf_iterator<char>());
+  }
+  cacheInput.close();
+
+  // Trust the cache without reading the script if nothing has changed
+  bool isFresh = !bytecode.empty() && cached.modified == current.modified && cached.size == current.size;
+
+  // Otherwise compare contents, the file may only have been touched
+  std::string source;
+  if (!isFresh) {
+    std::ifstream input(fp, std::ios::binary);
+    source.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    current.hash = hash(source.data(), source.size());
+    isFresh = !bytecode.empty() && cached.size == current.size && cached.hash == current.hash;
+  }
+  else {
+    current.hash = cached.hash;
+  }
+
+  // Use the cached bytecode
+  if (isFresh) {
+    sol::load_result loaded = lua.load_buffer(bytecode.data(), bytecode.size(), chunkName, sol::load_mode::binary);
+    if (loaded.valid()) {
+      ++hits_;
+
+      // Remember the new time so the script isn't read next time
+      if (cached.modified != current.modified) {
+        std::ofstream output(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+        output.write(reinterpret_cast<const char*>(&current), sizeof(current));
+      }
+      return finish(loaded);
+    }
+  }
+
+  // The script has to be read if the cache was trusted but unusable
+  if (source.empty()) {
+    std::ifstream input(fp, std::ios::binary);
+    source.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    current.hash = hash(source.data(), source.size());
+  }
+
+  // Compile the script
+  ++misses_;
+  sol::load_result loaded = lua.load_buffer(source.data(), source.size(), chunkName, sol::load_mode::text);
+  if (!loaded.valid()) { return finish(loaded); }
+
+  // Save the bytecode for next time
+  sol::unsafe_function compiled = loaded.get<sol::unsafe_function>();
+  const sol::bytecode dumped = compiled.dump();
+  std::filesystem::create_directories(directory_, ec);
+  std::ofstream output(cachePath, std::ios::binary | std::ios::trunc);
+  output.write(reinterpret_cast<const char*>(&current), sizeof(current));
+  output.write(reinterpret_cast<const char*>(dumped.data()), dumped.size());
+  if (!output.good()) {
+    Console::log("[Warning] Could not write script cache for %s.", fp.c_str());
+  }
+  return finish(loaded);
+}
+
+// Enable or disable writing and reading the cache
+void
+ScriptCache::setEnabled(bool enable) {
+  isEnabled_ = enable;
+}
+
+// Get the amount of scripts loaded from the cache
+unsigned
+ScriptCache::getHitCount() {
+  return hits_;
+}
+
+// Get the amount of scripts that had to be compiled
+unsigned
+ScriptCache::getMissCount() {
+  return misses_;
+}
+
+// Hash some bytes with FNV-1a
+sf::Uint64
+ScriptCache::hash(const char* data, std::size_t size) {
+  sf::Uint64 h = 14695981039346656037ULL;
+  for (std::size_t i = 0; i < size; ++i) {
+    h ^= static_cast<unsigned char>(data[i]);
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
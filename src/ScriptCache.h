@@ -0,0 +1,49 @@
+// ScriptCache.h
+// Keeps compiled Lua bytecode on disk so scripts aren't parsed every launch
+
+#ifndef SCRIPTCACHE_H
+#define SCRIPTCACHE_H
+
+#include <atomic>
+#include <string>
+
+#include <SFML/Config.hpp>
+
+#include "Sol.h"
+
+// Static class that loads scripts through a bytecode cache
+class ScriptCache {
+  public:
+
+    // Load a script without running it, using cached bytecode when it's fresh
+    // Returns false and fills error if the script can't be loaded
+    // Safe to call from any thread as long as each thread uses its own state
+    static bool load(sol::state_view lua, const std::string& fp,
+      sol::protected_function& chunk, std::string& error);
+
+    // Enable or disable writing and reading the cache
+    static void setEnabled(bool enable);
+
+    // Statistics for the startup report
+    static unsigned getHitCount();
+    static unsigned getMissCount();
+
+  private:
+
+    // Directory that holds cached bytecode
+    static const std::string directory_;
+
+    // Whether the cache is used
+    static bool isEnabled_;
+
+    // Amount of scripts loaded from the cache
+    static std::atomic<unsigned> hits_;
+
+    // Amount of scripts that had to be compiled
+    static std::atomic<unsigned> misses_;
+
+    // Hash some bytes
+    static sf::Uint64 hash(const char* data, std::size_t size);
+};
+
+#endif
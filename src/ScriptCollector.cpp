@@ -0,0 +1,198 @@
+// ScriptCollector.cpp
+// Runs Lua's garbage collector in slices between frames instead of mid-frame
+
+#include "ScriptCollector.h"
+
+// Avoid cyclic dependencies
+#include "Game.h"
+
+// Heap size below which cycles aren't worth starting, in KB
+static const float minimumHeap = 1024.f;
+
+// How far past the threshold the heap can grow before slices are given up on
+static const float emergencyMultiple = 4.f;
+
+// Initialise static members
+bool ScriptCollector::automatic_ = false;
+bool ScriptCollector::collecting_ = false;
+float ScriptCollector::frameRate_ = 60.f;
+float ScriptCollector::minStepTime_ = 0.1f;
+float ScriptCollector::maxStepTime_ = 2.f;
+float ScriptCollector::pause_ = 200.f;
+float ScriptCollector::liveHeap_ = minimumHeap;
+unsigned ScriptCollector::cycles_ = 0;
+RollingHistory ScriptCollector::stepTime_;
+RollingHistory ScriptCollector::heapSize_;
+
+// Allow the collector to be controlled from Lua, and take over collection
+void
+ScriptCollector::registerCollectorType() {
+
+  // Allocations no longer start collection, the game loop steps it instead
+  lua_gc(Game::lua.lua_state(), LUA_GCSTOP, 0);
+  liveHeap_ = std::max(getHeapKB(), minimumHeap);
+
+  // Register the collector
+  Game::lua.set("Collector", ScriptCollector());
+  Game::lua.new_usertype<ScriptCollector>("ScriptCollector",
+    "collect", &ScriptCollector::collect,
+    "automatic", sol::property(
+      &ScriptCollector::getAutomatic,
+      &ScriptCollector::setAutomatic),
+    "frameRate", sol::property(
+      &ScriptCollector::getFrameRate,
+      &ScriptCollector::setFrameRate),
+    "maxStepTime", sol::property(
+      &ScriptCollector::getMaxStepTime,
+      &ScriptCollector::setMaxStepTime),
+    "pause", sol::property(
+      &ScriptCollector::getPause,
+      &ScriptCollector::setPause),
+    "heapSize", sol::property(&ScriptCollector::getHeapSize)
+  );
+
+  // Add to auto complete
+  Console::addCommand("[Class] Collector");
+  Console::addCommand("Collector:collect");
+  Console::addCommand("Collector.automatic");
+  Console::addCommand("Collector.frameRate");
+  Console::addCommand("Collector.maxStepTime");
+  Console::addCommand("Collector.pause");
+  Console::addCommand("Collector.heapSize");
+}
+
+// Collect in the time left over this frame, given how long the frame has taken so far
+void
+ScriptCollector::step(const sf::Time& frameTime) {
+  const float heap = getHeapKB();
+  heapSize_.push(heap / 1024.f);
+  if (automatic_) {
+    stepTime_.push(0.f);
+    return;
+  }
+
+  // Start a cycle once the heap has grown enough since the last one finished
+  const float threshold = liveHeap_ * pause_ / 100.f;
+  if (!collecting_ && heap >= threshold) {
+    collecting_ = true;
+  }
+  if (!collecting_) {
+    stepTime_.push(0.f);
+    return;
+  }
+
+  // Scripts are allocating faster than slices can collect, so take the hitch rather than run out of memory
+  if (heap >= threshold * emergencyMultiple) {
+    sf::Clock clock;
+    collect();
+    stepTime_.push(clock.getElapsedTime().asSeconds() * 1000.f);
+    Console::log("[Warning] Lua heap reached %.1fMB, faster than the collector could keep up. "
+      "Ran a full collection in %.1fms, consider raising Collector.maxStepTime.",
+      heap / 1024.f, stepTime_.latest());
+    return;
+  }
+
+  // Use the spare time in the frame, or the longest slice if garbage is piling up
+  const float leftover = 1000.f / frameRate_ - frameTime.asSeconds() * 1000.f;
+  float budget = std::min(std::max(leftover, minStepTime_), maxStepTime_);
+  if (heap >= threshold * 2.f) {
+    budget = maxStepTime_;
+  }
+
+  // Take small steps until out of time or the cycle finishes
+  // Lua 5.1 and LuaJIT restart automatic collection after a cycle, so stop it again
+  lua_State* L = Game::lua.lua_state();
+  sf::Clock clock;
+  while (collecting_ && clock.getElapsedTime().asSeconds() * 1000.f < budget) {
+    if (lua_gc(L, LUA_GCSTEP, 0)) {
+      lua_gc(L, LUA_GCSTOP, 0);
+      collecting_ = false;
+      liveHeap_ = std::max(getHeapKB(), minimumHeap);
+      ++cycles_;
+    }
+  }
+  stepTime_.push(clock.getElapsedTime().asSeconds() * 1000.f);
+}
+
+// Run a full collection, for when a hitch won't be noticed
+void
+ScriptCollector::collect() {
+  lua_State* L = Game::lua.lua_state();
+  lua_gc(L, LUA_GCCOLLECT, 0);
+  if (!automatic_) {
+    lua_gc(L, LUA_GCSTOP, 0);
+  }
+  collecting_ = false;
+  liveHeap_ = std::max(getHeapKB(), minimumHeap);
+  ++cycles_;
+}
+
+// Let Lua collect whenever allocations trigger it, instead of between frames
+void
+ScriptCollector::setAutomatic(bool automatic) {
+  lua_gc(Game::lua.lua_state(), automatic ? LUA_GCRESTART : LUA_GCSTOP, 0);
+  automatic_ = automatic;
+}
+
+// Check if Lua collects on its own
+bool
+ScriptCollector::getAutomatic() {
+  return automatic_;
+}
+
+// Set the frame rate to fit collection slices into
+void
+ScriptCollector::setFrameRate(float rate) {
+  frameRate_ = std::max(1.f, rate);
+}
+
+// Get the frame rate to fit collection slices into
+float
+ScriptCollector::getFrameRate() {
+  return frameRate_;
+}
+
+// Set the longest slice in milliseconds
+void
+ScriptCollector::setMaxStepTime(float ms) {
+  maxStepTime_ = std::max(minStepTime_, ms);
+}
+
+// Get the longest slice in milliseconds
+float
+ScriptCollector::getMaxStepTime() {
+  return maxStepTime_;
+}
+
+// Set how much the heap grows before a new cycle starts
+void
+ScriptCollector::setPause(float percent) {
+  pause_ = std::max(100.f, percent);
+}
+
+// Get how much the heap grows before a new cycle starts
+float
+ScriptCollector::getPause() {
+  return pause_;
+}
+
+// Get the size of the Lua heap in MB
+float
+ScriptCollector::getHeapSize() {
+  return getHeapKB() / 1024.f;
+}
+
+// Show collector information in the debug window
+void
+ScriptCollector::showDebugInformation() {
+  ImGui::Text("Lua Heap: %.1fMB (%u cycles%s)", heapSize_.latest(), cycles_,
+    automatic_ ? ", automatic" : collecting_ ? ", collecting" : "");
+  stepTime_.plotLines("Lua GC (ms)");
+}
+
+// Get the size of the Lua heap in KB
+float
+ScriptCollector::getHeapKB() {
+  lua_State* L = Game::lua.lua_state();
+  return lua_gc(L, LUA_GCCOUNT, 0) + lua_gc(L, LUA_GCCOUNTB, 0) / 1024.f;
+}
@@ -0,0 +1,78 @@
+// ScriptCollector.h
+// Runs Lua's garbage collector in slices between frames instead of mid-frame
+
+#ifndef SCRIPTCOLLECTOR_H
+#define SCRIPTCOLLECTOR_H
+
+#include <SFML/System.hpp>
+
+#include "Common.h"
+
+// Static class that takes Lua's incremental collector off allocations and steps it every frame
+class ScriptCollector {
+  public:
+
+    // Allow the collector to be controlled from Lua, and take over collection
+    static void registerCollectorType();
+
+    // Collect in the time left over this frame, given how long the frame has taken so far
+    static void step(const sf::Time& frameTime);
+
+    // Run a full collection, for when a hitch won't be noticed
+    static void collect();
+
+    // Let Lua collect whenever allocations trigger it, instead of between frames
+    static void setAutomatic(bool automatic);
+    static bool getAutomatic();
+
+    // Frame rate to fit collection slices into
+    static void setFrameRate(float rate);
+    static float getFrameRate();
+
+    // Longest slice in milliseconds, used even without spare time once garbage builds up
+    static void setMaxStepTime(float ms);
+    static float getMaxStepTime();
+
+    // How much the heap grows, in percent of what survived the last cycle, before a new one starts
+    static void setPause(float percent);
+    static float getPause();
+
+    // Get the size of the Lua heap in MB
+    static float getHeapSize();
+
+    // Show collector information in the debug window
+    static void showDebugInformation();
+
+  private:
+
+    // Get the size of the Lua heap in KB
+    static float getHeapKB();
+
+    // Whether Lua collects on its own
+    static bool automatic_;
+
+    // Whether a cycle is in progress
+    static bool collecting_;
+
+    // Frame rate to fit collection slices into
+    static float frameRate_;
+
+    // Shortest and longest slices in milliseconds
+    static float minStepTime_;
+    static float maxStepTime_;
+
+    // Heap growth before a cycle starts, in percent
+    static float pause_;
+
+    // Heap size in KB when the last cycle finished
+    static float liveHeap_;
+
+    // Amount of finished cycles
+    static unsigned cycles_;
+
+    // Time spent collecting and heap size every frame
+    static RollingHistory stepTime_;
+    static RollingHistory heapSize_;
+};
+
+#endif
@@ -0,0 +1,226 @@
+// ScriptEvents.cpp
+// Engine events queued as they happen and handed to Lua in batches
+
+#include "ScriptEvents.h"
+
+#include <algorithm>
+
+// Avoid cyclic dependencies
+#include "Game.h"
+#include "ScriptProfiler.h"
+#include "ScriptWatchdog.h"
+
+// Initialise static members
+std::unordered_map<std::string, ScriptEvents::WatchFunction> ScriptEvents::watchers_;
+
+// Constructor
+ScriptEvents::ScriptEvents()
+  : world_(nullptr)
+  , isDispatching_(false)
+  , nextId_(1) {
+}
+
+// Let a scene's scripts subscribe to this world's events
+void
+ScriptEvents::registerFunctions(sol::environment& env, ECS::World* world) {
+
+  // Listen to the world once, subscriptions outlive the environment
+  if (world_ != world) {
+    clear();
+    world_ = world;
+    world_->subscribe<ContactEvent>(this);
+    world_->subscribe<DeathEvent>(this);
+    world_->subscribe<ExpireEvent>(this);
+    world_->subscribe<ECS::Events::OnSystemUpdated>(this);
+  }
+
+  // Each callback is given a table of everything that happened since the last batch
+  env.set_function("onContact", [this](const sol::protected_function& f) {
+    return subscribe(contactChannel_, f); });
+  env.set_function("onDeath", [this](const sol::protected_function& f) {
+    return subscribe(deathChannel_, f); });
+  env.set_function("onExpire", [this](const sol::protected_function& f) {
+    return subscribe(expireChannel_, f); });
+  env.set_function("onComponentAssigned", [this](const std::string& name, const sol::protected_function& f) {
+    auto watcher = watchers_.find(name);
+    if (watcher == watchers_.end()) {
+      Console::log("[Error] Could not watch %s, it is not a component.", name.c_str());
+      return 0u;
+    }
+    Channel& channel = assignChannels_[name];
+    if (channel.watcher == nullptr) {
+      channel.watcher = watcher->second(world_, channel.entities);
+    }
+    return subscribe(channel, f);
+  });
+  env.set_function("unsubscribe", [this](unsigned id) { unsubscribe(id); });
+
+  // Add to auto complete
+  Console::addCommand("World.onContact");
+  Console::addCommand("World.onDeath");
+  Console::addCommand("World.onExpire");
+  Console::addCommand("World.onComponentAssigned");
+  Console::addCommand("World.unsubscribe");
+}
+
+// Call subscribers with everything queued
+void
+ScriptEvents::dispatch() {
+  if (isDispatching_) { return; }
+  isDispatching_ = true;
+
+  // Contacts are given as { entity, other, impact }
+  if (!contacts_.empty()) {
+    std::vector<ContactEvent> contacts;
+    contacts.swap(contacts_);
+    sol::table batch = Game::lua.create_table(contacts.size(), 0);
+    for (std::size_t i = 0; i < contacts.size(); ++i) {
+      batch[i + 1] = Game::lua.create_table_with(
+        "entity", contacts[i].entity,
+        "other", contacts[i].other,
+        "impact", contacts[i].impact);
+    }
+    call(contactChannel_, batch, "onContact");
+  }
+
+  // Everything else is given as a list of entities
+  dispatchEntities(deathChannel_, "onDeath");
+  dispatchEntities(expireChannel_, "onExpire");
+  if (!assignChannels_.empty()) {
+
+    // Callbacks may watch new components, so don't iterate the map itself
+    std::vector<Channel*> channels;
+    channels.reserve(assignChannels_.size());
+    for (auto& channel : assignChannels_) {
+      channels.push_back(&channel.second);
+    }
+    for (Channel* channel : channels) {
+      dispatchEntities(*channel, "onComponentAssigned");
+    }
+  }
+  isDispatching_ = false;
+}
+
+// Unsubscribe every script and stop listening to the world
+void
+ScriptEvents::clear() {
+  if (world_ != nullptr) {
+    world_->unsubscribe<ContactEvent>(this);
+    world_->unsubscribe<DeathEvent>(this);
+    world_->unsubscribe<ExpireEvent>(this);
+    world_->unsubscribe<ECS::Events::OnSystemUpdated>(this);
+  }
+  world_ = nullptr;
+  contacts_.clear();
+  contactChannel_ = Channel();
+  deathChannel_ = Channel();
+  expireChannel_ = Channel();
+  assignChannels_.clear();
+}
+
+// Get the amount of script subscriptions
+std::size_t
+ScriptEvents::getCount() const {
+  std::size_t count = contactChannel_.callbacks.size()
+    + deathChannel_.callbacks.size()
+    + expireChannel_.callbacks.size();
+  for (const auto& channel : assignChannels_) {
+    count += channel.second.callbacks.size();
+  }
+  return count;
+}
+
+// Queue contacts while scripts want them
+void
+ScriptEvents::receive(ECS::World* world, const ContactEvent& event) {
+  if (!contactChannel_.callbacks.empty()) {
+    contacts_.push_back(event);
+  }
+}
+
+// Queue deaths while scripts want them
+void
+ScriptEvents::receive(ECS::World* world, const DeathEvent& event) {
+  if (!deathChannel_.callbacks.empty()) {
+    deathChannel_.entities.push_back(event.entity);
+  }
+}
+
+// Queue expiries while scripts want them
+void
+ScriptEvents::receive(ECS::World* world, const ExpireEvent& event) {
+  if (!expireChannel_.callbacks.empty()) {
+    expireChannel_.entities.push_back(event.entity);
+  }
+}
+
+// Dispatch once a system has updated
+void
+ScriptEvents::receive(ECS::World* world, const ECS::Events::OnSystemUpdated& event) {
+  dispatch();
+}
+
+// Subscribe a script to a channel
+unsigned
+ScriptEvents::subscribe(Channel& channel, const sol::protected_function& callback) {
+  const unsigned id = nextId_++;
+  channel.callbacks.push_back(std::make_pair(id, callback));
+  return id;
+}
+
+// Unsubscribe a script from whichever channel it is in
+void
+ScriptEvents::unsubscribe(unsigned id) {
+  auto remove = [id](Channel& channel) {
+    auto& callbacks = channel.callbacks;
+    auto it = std::find_if(callbacks.begin(), callbacks.end(),
+      [id](const std::pair<unsigned, sol::protected_function>& c) { return c.first == id; });
+    if (it == callbacks.end()) { return false; }
+    callbacks.erase(it);
+
+    // Nothing is queued for a channel without subscribers
+    if (callbacks.empty()) {
+      channel.entities.clear();
+      channel.watcher.reset();
+    }
+    return true;
+  };
+  if (remove(contactChannel_)) {
+    if (contactChannel_.callbacks.empty()) { contacts_.clear(); }
+    return;
+  }
+  if (remove(deathChannel_) || remove(expireChannel_)) { return; }
+  for (auto& channel : assignChannels_) {
+    if (remove(channel.second)) { return; }
+  }
+}
+
+// Call a channel's subscribers with a batch
+void
+ScriptEvents::call(const Channel& channel, const sol::table& batch, const char* name) {
+
+  // Callbacks may subscribe or unsubscribe, so call a copy
+  const auto callbacks = channel.callbacks;
+  for (const auto& callback : callbacks) {
+    ScriptProfiler::Scope scope("ScriptEvents::dispatch", name);
+    ScriptWatchdog::Budget budget(name);
+    auto attempt = callback.second(batch);
+    if (!attempt.valid()) {
+      sol::error err = attempt;
+      Console::log("[Error] in World.%s callback:\n> %s", name, err.what());
+    }
+  }
+}
+
+// Call a channel's subscribers with its entities
+void
+ScriptEvents::dispatchEntities(Channel& channel, const char* name) {
+  if (channel.entities.empty()) { return; }
+  std::vector<ECS::Entity*> entities;
+  entities.swap(channel.entities);
+  sol::table batch = Game::lua.create_table(entities.size(), 0);
+  for (std::size_t i = 0; i < entities.size(); ++i) {
+    batch[i + 1] = entities[i];
+  }
+  call(channel, batch, name);
+}
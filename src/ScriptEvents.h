@@ -0,0 +1,145 @@
+// ScriptEvents.h
+// Engine events queued as they happen and handed to Lua in batches
+
+#ifndef SCRIPTEVENTS_H
+#define SCRIPTEVENTS_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ECS.h"
+#include "Sol.h"
+
+// A rigid body started touching another, which may have no entity
+struct ContactEvent {
+  ECS::Entity* entity;
+  ECS::Entity* other;
+  double impact;
+};
+
+// An entity's health reached zero
+struct DeathEvent {
+  ECS::Entity* entity;
+};
+
+// An entity's Expire component ran out
+struct ExpireEvent {
+  ECS::Entity* entity;
+};
+
+// Queues a scene's engine events and calls the scripts subscribed to them
+// Callbacks get every event since the last batch at once, after each system updates
+class ScriptEvents
+: public ECS::EventSubscriber<ContactEvent>
+, public ECS::EventSubscriber<DeathEvent>
+, public ECS::EventSubscriber<ExpireEvent>
+, public ECS::EventSubscriber<ECS::Events::OnSystemUpdated> {
+  public:
+
+    // Allow a component type to be watched with onComponentAssigned
+    template <typename T>
+    static void registerComponent(const std::string& name) {
+      watchers_[name] = &ScriptEvents::watch<T>;
+    }
+
+    // Constructor
+    ScriptEvents();
+
+    // Let a scene's scripts subscribe to this world's events
+    void registerFunctions(sol::environment& env, ECS::World* world);
+
+    // Call subscribers with everything queued
+    void dispatch();
+
+    // Unsubscribe every script and stop listening to the world
+    void clear();
+
+    // Get the amount of script subscriptions
+    std::size_t getCount() const;
+
+    // Queue events from the world
+    virtual void receive(ECS::World* world, const ContactEvent& event) override;
+    virtual void receive(ECS::World* world, const DeathEvent& event) override;
+    virtual void receive(ECS::World* world, const ExpireEvent& event) override;
+
+    // Dispatch once a system has updated
+    virtual void receive(ECS::World* world, const ECS::Events::OnSystemUpdated& event) override;
+
+  private:
+
+    // Listens for one type of component being assigned
+    class Watcher {
+      public:
+        virtual ~Watcher() {}
+    };
+    template <typename T>
+    class ComponentWatcher
+    : public Watcher
+    , public ECS::EventSubscriber<ECS::Events::OnComponentAssigned<T>> {
+      public:
+        ComponentWatcher(ECS::World* world, std::vector<ECS::Entity*>& queue)
+          : world_(world)
+          , queue_(queue) {
+          world_->subscribe<ECS::Events::OnComponentAssigned<T>>(this);
+        }
+        ~ComponentWatcher() {
+          world_->unsubscribe<ECS::Events::OnComponentAssigned<T>>(this);
+        }
+        virtual void receive(ECS::World* world, const ECS::Events::OnComponentAssigned<T>& event) override {
+          queue_.push_back(event.entity);
+        }
+      private:
+        ECS::World* world_;
+        std::vector<ECS::Entity*>& queue_;
+    };
+
+    // Start watching a type of component
+    typedef std::unique_ptr<Watcher> (*WatchFunction)(ECS::World*, std::vector<ECS::Entity*>&);
+    template <typename T>
+    static std::unique_ptr<Watcher> watch(ECS::World* world, std::vector<ECS::Entity*>& queue) {
+      return std::unique_ptr<Watcher>(new ComponentWatcher<T>(world, queue));
+    }
+
+    // Scripts subscribed to a kind of event, and the entities it happened to
+    struct Channel {
+      std::vector<std::pair<unsigned, sol::protected_function>> callbacks;
+      std::vector<ECS::Entity*> entities;
+      std::unique_ptr<Watcher> watcher;
+    };
+
+    // Subscribe a script to a channel, events are only queued while a channel has subscribers
+    unsigned subscribe(Channel& channel, const sol::protected_function& callback);
+
+    // Unsubscribe a script from whichever channel it is in
+    void unsubscribe(unsigned id);
+
+    // Call a channel's subscribers with a batch
+    static void call(const Channel& channel, const sol::table& batch, const char* name);
+
+    // Call a channel's subscribers with its entities
+    static void dispatchEntities(Channel& channel, const char* name);
+
+    // Ways to watch each scriptable component, by name
+    static std::unordered_map<std::string, WatchFunction> watchers_;
+
+    // The world being listened to
+    ECS::World* world_;
+
+    // Queued contacts, and channels for each kind of event
+    std::vector<ContactEvent> contacts_;
+    Channel contactChannel_;
+    Channel deathChannel_;
+    Channel expireChannel_;
+    std::unordered_map<std::string, Channel> assignChannels_;
+
+    // Whether events are being dispatched, so dispatching never recurses
+    bool isDispatching_;
+
+    // ID for the next subscription, 0 is never used
+    unsigned nextId_;
+};
+
+#endif
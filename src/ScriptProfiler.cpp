@@ -0,0 +1,363 @@
+// ScriptProfiler.cpp
+// Times Lua functions and the C++ functions that call into them
+
+#include "ScriptProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+// Avoid cyclic dependencies
+#include "Game.h"
+#include "ScriptWatchdog.h"
+
+// Where the window's export button writes to
+static const char* exportPath = "script-profile.folded";
+
+// Initialise static members
+bool ScriptProfiler::enabled_ = false;
+bool ScriptProfiler::showWindow_ = false;
+unsigned ScriptProfiler::frames_ = 0;
+std::vector<ScriptProfiler::Node> ScriptProfiler::nodes_;
+std::unordered_map<lua_State*, std::vector<ScriptProfiler::Frame>> ScriptProfiler::stacks_;
+
+// Name a function the way it shows in the call tree
+static std::string
+describeFunction(const lua_Debug* ar) {
+  const std::string name = ar->name != nullptr ? ar->name : "?";
+  if (ar->what[0] == 'C') {
+    return name + " [C]";
+  }
+  if (ar->what[0] == 'm') {
+    return std::string("main chunk (") + ar->short_src + ")";
+  }
+  return name + " (" + ar->short_src + ":" + std::to_string(ar->linedefined) + ")";
+}
+
+// Allow the profiler to be controlled from Lua
+void
+ScriptProfiler::registerProfilerType() {
+  reset();
+
+  // Register the profiler
+  Game::lua.set("Profiler", ScriptProfiler());
+  Game::lua.new_usertype<ScriptProfiler>("ScriptProfiler",
+    "enabled", sol::property(
+      &ScriptProfiler::isEnabled,
+      &ScriptProfiler::setEnabled),
+    "reset", &ScriptProfiler::reset,
+    "export", [](const ScriptProfiler&, const std::string& fp) {
+      return ScriptProfiler::exportCollapsed(fp); }
+  );
+
+  // Add to auto complete
+  Console::addCommand("[Class] Profiler");
+  Console::addCommand("Profiler.enabled");
+  Console::addCommand("Profiler:reset");
+  Console::addCommand("Profiler:export");
+}
+
+// Start or stop profiling, starting clears the previous results
+void
+ScriptProfiler::setEnabled(bool enable) {
+  if (enable == enabled_) { return; }
+  enabled_ = enable;
+
+  // The watchdog installs the hook, coroutines it's already watching pick up the change when it next runs
+  ScriptWatchdog::updateHook();
+  if (enable) {
+    reset();
+#if defined(SOL_LUAJIT) && SOL_LUAJIT
+    // Compiled traces don't call hooks, so interpret everything while profiling
+    luaJIT_setmode(Game::lua.lua_state(), 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_OFF);
+#endif
+    showWindow_ = true;
+    Console::log("[Note] Script profiler started, export with Profiler:export(\"file\").");
+  }
+  else {
+#if defined(SOL_LUAJIT) && SOL_LUAJIT
+    luaJIT_setmode(Game::lua.lua_state(), 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_ON);
+#endif
+    stacks_.clear();
+    Console::log("[Note] Script profiler stopped after %u frames.", frames_);
+  }
+}
+
+// Check if the profiler is running
+bool
+ScriptProfiler::isEnabled() {
+  return enabled_;
+}
+
+// Clear the results
+void
+ScriptProfiler::reset() {
+  nodes_.clear();
+  nodes_.push_back(Node{ "Scripts", -1, 0.0, 0.0, 0, {} });
+  stacks_.clear();
+  frames_ = 0;
+}
+
+// Count a frame, so times can be shown per frame
+void
+ScriptProfiler::countFrame() {
+  if (enabled_) { ++frames_; }
+}
+
+// Forget a coroutine's running calls once it is let go, a new one may reuse its address
+void
+ScriptProfiler::releaseThread(lua_State* thread) {
+  stacks_.erase(thread);
+}
+
+// Write every call stack and its self time in microseconds, one per line
+bool
+ScriptProfiler::exportCollapsed(const std::string& fp) {
+  std::ofstream file(fp);
+  if (!file) {
+    Console::log("[Error] Could not write script profile to %s.", fp.c_str());
+    return false;
+  }
+
+  // Semicolons separate the functions in a stack, so they can't be in names
+  auto frameName = [](std::string name) {
+    std::replace(name.begin(), name.end(), ';', ':');
+    return name;
+  };
+
+  // Write a line for every node that spent time itself
+  for (std::size_t i = 1; i < nodes_.size(); ++i) {
+    const long long self = std::llround(nodes_[i].self);
+    if (self <= 0) { continue; }
+    std::string stack = frameName(nodes_[i].name);
+    for (int parent = nodes_[i].parent; parent > 0; parent = nodes_[parent].parent) {
+      stack = frameName(nodes_[parent].name) + ";" + stack;
+    }
+    file << stack << ' ' << self << '\n';
+  }
+  Console::log("Wrote script profile of %u frames to %s.", frames_, fp.c_str());
+  return true;
+}
+
+// Add an entry to the debug view menu
+void
+ScriptProfiler::addDebugMenuEntry() {
+  ImGui::MenuItem("Script Profiler", NULL, &showWindow_);
+}
+
+// Show the profiler window if it's open
+void
+ScriptProfiler::showDebugWindow() {
+  if (!showWindow_) { return; }
+  ImGui::Begin("Script Profiler", &showWindow_);
+
+  // Controls
+  bool enabled = enabled_;
+  if (ImGui::Checkbox("Enabled", &enabled)) {
+    setEnabled(enabled);
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Reset")) {
+    reset();
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Export")) {
+    exportCollapsed(exportPath);
+  }
+  const double frames = std::max(frames_, 1u);
+  ImGui::Text("%u frames, %.3fms of scripts per frame", frames_, nodes_[0].total / 1000.0 / frames);
+  ImGui::Spacing();
+
+  // Call tree, with the time spent in each function and everything it called
+  ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(2,2));
+  ImGui::Columns(4);
+  ImGui::Separator();
+  ImGui::Text("Function");
+  ImGui::NextColumn();
+  ImGui::Text("Total ms/frame");
+  ImGui::NextColumn();
+  ImGui::Text("Self ms/frame");
+  ImGui::NextColumn();
+  ImGui::Text("Calls/frame");
+  ImGui::NextColumn();
+  ImGui::Separator();
+  for (int child : sortChildren(0)) {
+    showNode(child, nodes_[0].total);
+  }
+  ImGui::Columns(1);
+  ImGui::Separator();
+  ImGui::PopStyleVar();
+
+  // Functions with the most time spent in them, wherever they were called from
+  if (ImGui::CollapsingHeader("Hottest Functions")) {
+    std::map<std::string, std::pair<double, unsigned>> functions;
+    for (std::size_t i = 1; i < nodes_.size(); ++i) {
+      auto& function = functions[nodes_[i].name];
+      function.first += nodes_[i].self;
+      function.second += nodes_[i].calls;
+    }
+    std::vector<std::pair<std::string, std::pair<double, unsigned>>> sorted(functions.begin(), functions.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+      return a.second.first > b.second.first;
+    });
+    for (std::size_t i = 0; i < sorted.size() && i < 20; ++i) {
+      ImGui::Text("%.3fms %.1f calls %s", sorted[i].second.first / 1000.0 / frames,
+        sorted[i].second.second / frames, sorted[i].first.c_str());
+    }
+  }
+  ImGui::End();
+}
+
+// Called by the watchdog's hook when a function is called or returns
+void
+ScriptProfiler::hook(lua_State* L, lua_Debug* ar) {
+  const int depth = getDepth(L);
+  auto& stack = stacks_[L];
+
+  // Calls
+#ifdef LUA_HOOKTAILCALL
+  if (ar->event == LUA_HOOKCALL || ar->event == LUA_HOOKTAILCALL) {
+#else
+  if (ar->event == LUA_HOOKCALL) {
+#endif
+    lua_getinfo(L, "nS", ar);
+    enter(stack, describeFunction(ar), depth, false);
+    return;
+  }
+
+  // Returns, errors unwind functions without calling the hook so deeper calls are stale
+  // Tail calls run at the depth of the function they replaced, so they return together
+  const auto now = Clock::now();
+  while (!stack.empty() && stack.back().depth > depth) {
+    leave(stack, now);
+  }
+  while (!stack.empty() && stack.back().depth == depth && !stack.back().isScope) {
+    leave(stack, now);
+  }
+
+  // A coroutine's body returned, so it has finished and its stack can go
+  if (stack.empty() && depth <= 1 && L != Game::lua.lua_state()) {
+    stacks_.erase(L);
+  }
+}
+
+// Push a call onto a stack
+void
+ScriptProfiler::enter(std::vector<Frame>& stack, const std::string& name, int depth, bool isScope) {
+
+  // Find the node for this function under its caller
+  const int parent = stack.empty() ? 0 : stack.back().node;
+  int index;
+  auto it = nodes_[parent].children.find(name);
+  if (it != nodes_[parent].children.end()) {
+    index = it->second;
+  }
+  else {
+    index = nodes_.size();
+    nodes_[parent].children[name] = index;
+    nodes_.push_back(Node{ name, parent, 0.0, 0.0, 0, {} });
+  }
+  ++nodes_[index].calls;
+
+  // Start timing last, so the lookup isn't counted
+  stack.push_back(Frame{ index, depth, isScope, Clock::now(), 0.0 });
+}
+
+// Pop the top call from a stack and add its time to the tree
+void
+ScriptProfiler::leave(std::vector<Frame>& stack, Clock::time_point now) {
+  const Frame frame = stack.back();
+  stack.pop_back();
+  const double elapsed = std::chrono::duration<double, std::micro>(now - frame.start).count();
+  Node& node = nodes_[frame.node];
+  node.total += elapsed;
+  node.self += elapsed - frame.children;
+  if (!stack.empty()) {
+    stack.back().children += elapsed;
+  }
+  else {
+    nodes_[0].total += elapsed;
+  }
+}
+
+// Enter a C++ call site
+void
+ScriptProfiler::enterScope(const char* site, const char* detail) {
+  lua_State* L = Game::lua.lua_state();
+  std::string name = site;
+  if (detail != nullptr) {
+    name += std::string(" (") + detail + ")";
+  }
+  enter(stacks_[L], name, getDepth(L), true);
+}
+
+// Leave a C++ call site
+void
+ScriptProfiler::leaveScope() {
+  auto& stack = stacks_[Game::lua.lua_state()];
+  const auto now = Clock::now();
+
+  // Lua calls left on top were unwound by an error
+  while (!stack.empty() && !stack.back().isScope) {
+    leave(stack, now);
+  }
+  if (!stack.empty()) {
+    leave(stack, now);
+  }
+}
+
+// Get the amount of Lua functions running on a thread
+int
+ScriptProfiler::getDepth(lua_State* L) {
+  lua_Debug ar;
+  int depth = 0;
+  while (lua_getstack(L, depth, &ar)) {
+    ++depth;
+  }
+  return depth;
+}
+
+// Get a node's children, most expensive first
+std::vector<int>
+ScriptProfiler::sortChildren(int index) {
+  std::vector<int> sorted;
+  sorted.reserve(nodes_[index].children.size());
+  for (const auto& child : nodes_[index].children) {
+    sorted.push_back(child.second);
+  }
+  std::sort(sorted.begin(), sorted.end(), [](int a, int b) {
+    return nodes_[a].total > nodes_[b].total;
+  });
+  return sorted;
+}
+
+// Show a node and its children in the window
+void
+ScriptProfiler::showNode(int index, double rootTotal) {
+  const Node& node = nodes_[index];
+  const double frames = std::max(frames_, 1u);
+  ImGui::PushID(index);
+  ImGui::AlignTextToFramePadding();
+  const ImGuiTreeNodeFlags flags = node.children.empty() ? ImGuiTreeNodeFlags_Leaf : ImGuiTreeNodeFlags_None;
+  const bool isOpen = ImGui::TreeNodeEx("Call", flags, "%s", node.name.c_str());
+  ImGui::NextColumn();
+
+  // Bar shows the share of all script time, like the width of a flame graph
+  char total[32];
+  std::snprintf(total, sizeof(total), "%.3f", node.total / 1000.0 / frames);
+  ImGui::ProgressBar(rootTotal > 0.0 ? node.total / rootTotal : 0.f, ImVec2(-1.f, 0.f), total);
+  ImGui::NextColumn();
+  ImGui::Text("%.3f", node.self / 1000.0 / frames);
+  ImGui::NextColumn();
+  ImGui::Text("%.1f", node.calls / frames);
+  ImGui::NextColumn();
+
+  // Children
+  if (isOpen) {
+    for (int child : sortChildren(index)) {
+      showNode(child, rootTotal);
+    }
+    ImGui::TreePop();
+  }
+  ImGui::PopID();
+}
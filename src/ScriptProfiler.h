@@ -0,0 +1,132 @@
+// ScriptProfiler.h
+// Times Lua functions and the C++ functions that call into them
+
+#ifndef SCRIPTPROFILER_H
+#define SCRIPTPROFILER_H
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Sol.h"
+
+// Static class using Lua's call and return hooks to build a call tree of script time
+class ScriptProfiler {
+  public:
+
+    // Marks a C++ function that calls Lua, so the script time it causes is attributed to it
+    // Costs a single check while the profiler is off
+    class Scope {
+      public:
+
+        // Enter the call site, the detail tells apart calls from the same site
+        explicit Scope(const char* site, const char* detail = nullptr)
+        : active_(enabled_) {
+          if (active_) { enterScope(site, detail); }
+        }
+
+        // Leave the call site
+        ~Scope() {
+          if (active_) { leaveScope(); }
+        }
+
+      private:
+
+        // Whether the profiler was running when the scope was entered
+        bool active_;
+    };
+
+    // Allow the profiler to be controlled from Lua
+    static void registerProfilerType();
+
+    // Start or stop profiling, starting clears the previous results
+    static void setEnabled(bool enable);
+    static bool isEnabled();
+
+    // Clear the results
+    static void reset();
+
+    // Count a frame, so times can be shown per frame
+    static void countFrame();
+
+    // Forget a coroutine's running calls once it is let go, a new one may reuse its address
+    static void releaseThread(lua_State* thread);
+
+    // Write every call stack and its self time in microseconds, one per line
+    // This is the collapsed format read by flamegraph tools
+    static bool exportCollapsed(const std::string& fp);
+
+    // Add an entry to the debug view menu
+    static void addDebugMenuEntry();
+
+    // Show the profiler window if it's open
+    static void showDebugWindow();
+
+  private:
+
+    // The watchdog owns the hook and calls the profiler's
+    friend class ScriptWatchdog;
+
+    // Clock used to time calls
+    typedef std::chrono::steady_clock Clock;
+
+    // A function in the call tree, the same function has a node for every path to it
+    struct Node {
+      std::string name;
+      int parent;
+      double total;
+      double self;
+      unsigned calls;
+      std::map<std::string, int> children;
+    };
+
+    // A call that has not returned yet
+    struct Frame {
+      int node;
+      int depth;
+      bool isScope;
+      Clock::time_point start;
+      double children;
+    };
+
+    // Called by the watchdog's hook when a function is called or returns
+    static void hook(lua_State* L, lua_Debug* ar);
+
+    // Push a call onto a stack
+    static void enter(std::vector<Frame>& stack, const std::string& name, int depth, bool isScope);
+
+    // Pop the top call from a stack and add its time to the tree
+    static void leave(std::vector<Frame>& stack, Clock::time_point now);
+
+    // Enter and leave C++ call sites
+    static void enterScope(const char* site, const char* detail);
+    static void leaveScope();
+
+    // Get the amount of Lua functions running on a thread
+    static int getDepth(lua_State* L);
+
+    // Get a node's children, most expensive first
+    static std::vector<int> sortChildren(int index);
+
+    // Show a node and its children in the window
+    static void showNode(int index, double rootTotal);
+
+    // Whether hooks are installed
+    static bool enabled_;
+
+    // Whether the window is open
+    static bool showWindow_;
+
+    // Frames counted while profiling
+    static unsigned frames_;
+
+    // Call tree, node 0 is the root
+    static std::vector<Node> nodes_;
+
+    // Running calls on each Lua thread, coroutines have their own stack
+    static std::unordered_map<lua_State*, std::vector<Frame>> stacks_;
+};
+
+#endif
@@ -0,0 +1,67 @@
+// ScriptProxy.h
+// Reuses the Lua userdata made for each component, so reading components doesn't allocate
+
+#ifndef SCRIPTPROXY_H
+#define SCRIPTPROXY_H
+
+#include "Sol.h"
+
+// Static class pushing components to Lua through a cache of proxies
+// Proxies are kept in a table per component type, keyed by the component's address,
+// values are weak so proxies Lua no longer uses are still collected
+class ScriptProxy {
+  public:
+
+    // Push a component, making a proxy only if there isn't one already
+    template <typename T>
+    static void push(lua_State* L, T* component) {
+      if (component == nullptr) {
+        lua_pushnil(L);
+        return;
+      }
+
+      // Look for an existing proxy
+      pushCache(L, getCache<T>());
+      lua_pushlightuserdata(L, component);
+      lua_rawget(L, -2);
+      if (!lua_isnil(L, -1)) {
+        lua_remove(L, -2);
+        return;
+      }
+      lua_pop(L, 1);
+
+      // Make one and remember it, leaving only the proxy on the stack
+      lua_pushlightuserdata(L, component);
+      sol::stack::push(L, component);
+      lua_pushvalue(L, -1);
+      lua_insert(L, -4);
+      lua_rawset(L, -3);
+      lua_pop(L, 1);
+    }
+
+  private:
+
+    // Reference to the cache of a component type
+    template <typename T>
+    static int& getCache() {
+      static int cache = LUA_NOREF;
+      return cache;
+    }
+
+    // Push a cache, creating it the first time
+    static void pushCache(lua_State* L, int& cache) {
+      if (cache != LUA_NOREF) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, cache);
+        return;
+      }
+      lua_newtable(L);
+      lua_newtable(L);
+      lua_pushstring(L, "v");
+      lua_setfield(L, -2, "__mode");
+      lua_setmetatable(L, -2);
+      lua_pushvalue(L, -1);
+      cache = luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+};
+
+#endif
@@ -0,0 +1,162 @@
+// ScriptSystem.cpp
+// Systems defined in Lua, given every matching component at once
+
+#include "ScriptSystem.h"
+
+// Avoid cyclic dependencies
+#include "Game.h"
+#include "ScriptProfiler.h"
+
+// Initialise static members
+std::unordered_map<std::string, ScriptSystem::ComponentType> ScriptSystem::components_;
+
+// Register World.registerSystem in the world
+void
+ScriptSystem::registerScriptSystem(sol::environment& env, ECS::World* world) {
+
+  // Create a system out of { name, query = { "Component", ... }, update = function(dt, view) }
+  env.set_function("registerSystem", [world](const sol::table& definition) -> ScriptSystem* {
+    const std::string name = definition.get_or<std::string>("name", "ScriptSystem");
+    sol::optional<sol::protected_function> update = definition["update"];
+    sol::optional<sol::table> query = definition["query"];
+    if (!update || !query) {
+      Console::log("[Error] Could not register system %s, it needs a query and an update function.", name.c_str());
+      return nullptr;
+    }
+
+    // Every queried component must be scriptable
+    std::vector<std::string> components;
+    for (std::size_t i = 1; i <= query.value().size(); ++i) {
+      const std::string component = query.value().get_or<std::string>(i, "");
+      if (components_.find(component) == components_.end()) {
+        Console::log("[Error] Could not register system %s, %s is not a component.", name.c_str(), component.c_str());
+        return nullptr;
+      }
+      components.push_back(component);
+    }
+
+    // The world manages the system from now on
+    Console::log("Initialising %s..", name.c_str());
+    auto* system = new ScriptSystem(name, components, update.value());
+    world->registerSystem(system);
+    return system;
+  });
+
+  // Create the ScriptSystem type
+  env.new_usertype<ScriptSystem>("ScriptSystem",
+    "enabled", &ScriptSystem::isEnabled,
+    "budget", &ScriptSystem::budget,
+    "count", sol::property(&ScriptSystem::getCount)
+  );
+
+  // Add to auto complete
+  Console::addCommand("World.registerSystem");
+}
+
+// Constructor
+ScriptSystem::ScriptSystem(const std::string& name, const std::vector<std::string>& query, const sol::protected_function& update)
+  : isEnabled(true)
+  , name_(name)
+  , queryNames_(query)
+  , update_(update)
+  , count_(0)
+  , isDirty_(true) {
+  for (const auto& component : query) {
+    query_.push_back(components_[component]);
+  }
+}
+
+// Listen for changes to the query
+void
+ScriptSystem::configure(ECS::World* world) {
+  world->subscribe<ECS::Events::OnEntityDestroyed>(this);
+  for (const auto& component : query_) {
+    watchers_.push_back(component.watch(world, *this));
+  }
+  isDirty_ = true;
+}
+
+// Stop listening for changes
+void
+ScriptSystem::unconfigure(ECS::World* world) {
+  world->unsubscribe<ECS::Events::OnEntityDestroyed>(this);
+  watchers_.clear();
+}
+
+// Call the Lua function with the view
+void
+ScriptSystem::update(ECS::World* world, const sf::Time& dt) {
+  if (!isEnabled) { return; }
+  ScriptProfiler::Scope scope("ScriptSystem::update", name_.c_str());
+
+  // The query only runs again once something it depends on changed
+  if (isDirty_) {
+    rebuild(world);
+  }
+
+  // One call covers every matching entity
+  ScriptWatchdog::Budget scriptBudget(name_.c_str(), budget);
+  auto attempt = update_(dt, view_);
+  if (!attempt.valid()) {
+    sol::error err = attempt;
+    Console::log("[Error] in %s.update():\n> %s", name_.c_str(), err.what());
+  }
+}
+
+// The view needs rebuilding when an entity in it is destroyed
+void
+ScriptSystem::receive(ECS::World* world, const ECS::Events::OnEntityDestroyed& event) {
+  invalidate(event.entity);
+}
+
+// Get the amount of entities matching the query
+std::size_t
+ScriptSystem::getCount() const {
+  return count_;
+}
+
+// Mark the view out of date if an entity that changed matches the query
+// Components are still attached while they're being removed or destroyed, and already attached once assigned,
+// so this covers entities that match after the change and ones that matched before it
+void
+ScriptSystem::invalidate(ECS::Entity* e) {
+  if (isDirty_) { return; }
+  for (const auto& component : query_) {
+    if (!component.has(e)) { return; }
+  }
+  isDirty_ = true;
+}
+
+// Find the matching entities and rebuild the view
+// The view is a new table so any the script kept stays as it was
+void
+ScriptSystem::rebuild(ECS::World* world) {
+  std::vector<ECS::Entity*> matches;
+  for (ECS::Entity* e : world->all()) {
+    bool isMatch = true;
+    for (std::size_t i = 0; i < query_.size() && isMatch; ++i) {
+      isMatch = query_[i].has(e);
+    }
+    if (isMatch) {
+      matches.push_back(e);
+    }
+  }
+
+  // Pack the entities and each of their components into arrays
+  view_ = Game::lua.create_table(0, query_.size() + 2);
+  sol::table entities = Game::lua.create_table(matches.size(), 0);
+  for (std::size_t i = 0; i < matches.size(); ++i) {
+    entities[i + 1] = matches[i];
+  }
+  view_["entities"] = entities;
+  for (std::size_t c = 0; c < query_.size(); ++c) {
+    sol::table components = Game::lua.create_table(matches.size(), 0);
+    for (std::size_t i = 0; i < matches.size(); ++i) {
+      query_[c].store(components, i + 1, matches[i]);
+    }
+    view_[queryNames_[c]] = components;
+  }
+  view_["count"] = matches.size();
+  count_ = matches.size();
+  isDirty_ = false;
+}
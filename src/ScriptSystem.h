@@ -0,0 +1,147 @@
+// ScriptSystem.h
+// Systems defined in Lua, given every matching component at once
+
+#ifndef SCRIPTSYSTEM_H
+#define SCRIPTSYSTEM_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <SFML/System.hpp>
+
+#include "ECS.h"
+#include "Sol.h"
+#include "ScriptProxy.h"
+#include "ScriptWatchdog.h"
+
+// A system whose update is a Lua function, called once per frame with a view of its query
+// The view holds the matching entities and an array of each queried component,
+// it is rebuilt only when an entity matching the query gains or loses a queried component or is destroyed
+class ScriptSystem
+: public ECS::EntitySystem
+, public ECS::EventSubscriber<ECS::Events::OnEntityDestroyed> {
+  public:
+
+    // Allow a component type to be used in queries
+    template <typename T>
+    static void registerComponent(const std::string& name) {
+      components_[name] = ComponentType{ &has<T>, &store<T>, &watch<T> };
+    }
+
+    // Register World.registerSystem in the world
+    static void registerScriptSystem(sol::environment& env, ECS::World* world);
+
+    // Constructor
+    ScriptSystem(const std::string& name, const std::vector<std::string>& query, const sol::protected_function& update);
+
+    // Listen for changes to the query
+    virtual void configure(ECS::World* world) override;
+
+    // Stop listening for changes
+    virtual void unconfigure(ECS::World* world) override;
+
+    // Call the Lua function with the view
+    virtual void update(ECS::World* world, const sf::Time& dt) override;
+
+    // The view needs rebuilding when an entity in it is destroyed
+    virtual void receive(ECS::World* world, const ECS::Events::OnEntityDestroyed& event) override;
+
+    // Get the amount of entities matching the query
+    std::size_t getCount() const;
+
+    // Whether the system runs
+    bool isEnabled;
+
+    // How long each update can run
+    ScriptWatchdog::Limits budget;
+
+  private:
+
+    // Listens for one type of component being assigned or removed from entities matching the query
+    class Watcher {
+      public:
+        virtual ~Watcher() {}
+    };
+    template <typename T>
+    class ComponentWatcher
+    : public Watcher
+    , public ECS::EventSubscriber<ECS::Events::OnComponentAssigned<T>>
+    , public ECS::EventSubscriber<ECS::Events::OnComponentRemoved<T>> {
+      public:
+        ComponentWatcher(ECS::World* world, ScriptSystem& system)
+          : world_(world)
+          , system_(system) {
+          world_->subscribe<ECS::Events::OnComponentAssigned<T>>(this);
+          world_->subscribe<ECS::Events::OnComponentRemoved<T>>(this);
+        }
+        ~ComponentWatcher() {
+          world_->unsubscribe<ECS::Events::OnComponentAssigned<T>>(this);
+          world_->unsubscribe<ECS::Events::OnComponentRemoved<T>>(this);
+        }
+        virtual void receive(ECS::World* world, const ECS::Events::OnComponentAssigned<T>& event) override {
+          system_.invalidate(event.entity);
+        }
+        virtual void receive(ECS::World* world, const ECS::Events::OnComponentRemoved<T>& event) override {
+          system_.invalidate(event.entity);
+        }
+      private:
+        ECS::World* world_;
+        ScriptSystem& system_;
+    };
+
+    // How to query and store one type of component
+    struct ComponentType {
+      bool (*has)(ECS::Entity*);
+      void (*store)(sol::table&, std::size_t, ECS::Entity*);
+      std::unique_ptr<Watcher> (*watch)(ECS::World*, ScriptSystem&);
+    };
+    template <typename T>
+    static bool has(ECS::Entity* e) {
+      return e->has<T>();
+    }
+    template <typename T>
+    static void store(sol::table& array, std::size_t index, ECS::Entity* e) {
+      lua_State* L = array.lua_state();
+      array.push();
+      ScriptProxy::push(L, &e->get<T>().get());
+      lua_rawseti(L, -2, (int)index);
+      array.pop();
+    }
+    template <typename T>
+    static std::unique_ptr<Watcher> watch(ECS::World* world, ScriptSystem& system) {
+      return std::unique_ptr<Watcher>(new ComponentWatcher<T>(world, system));
+    }
+
+    // Mark the view out of date if an entity that changed matches the query
+    void invalidate(ECS::Entity* e);
+
+    // Find the matching entities and rebuild the view
+    void rebuild(ECS::World* world);
+
+    // Components that can be queried, by name
+    static std::unordered_map<std::string, ComponentType> components_;
+
+    // Name shown when profiling
+    std::string name_;
+
+    // The queried components, and their names in the view
+    std::vector<ComponentType> query_;
+    std::vector<std::string> queryNames_;
+
+    // Listeners for changes to the query
+    std::vector<std::unique_ptr<Watcher>> watchers_;
+
+    // The Lua function to call
+    sol::protected_function update_;
+
+    // Entities and components matching the query, given to Lua
+    sol::table view_;
+    std::size_t count_;
+
+    // Whether the view is out of date
+    bool isDirty_;
+};
+
+#endif
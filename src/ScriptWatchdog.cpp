@@ -0,0 +1,279 @@
+// ScriptWatchdog.cpp
+// Stops Lua callbacks that run over their instruction or time budget
+
+#include "ScriptWatchdog.h"
+
+#include <algorithm>
+#include <limits>
+
+// Avoid cyclic dependencies
+#include "Game.h"
+#include "Replay.h"
+#include "ScriptProfiler.h"
+
+// Initialise static members
+bool ScriptWatchdog::enabled_ = true;
+unsigned long ScriptWatchdog::instructions_ = 10000000;
+float ScriptWatchdog::milliseconds_ = 10.f;
+float ScriptWatchdog::frameMilliseconds_ = 20.f;
+float ScriptWatchdog::loadingMilliseconds_ = 1000.f;
+unsigned long ScriptWatchdog::count_ = 0;
+float ScriptWatchdog::frameSpent_ = 0.f;
+ScriptWatchdog::Budget* ScriptWatchdog::current_ = nullptr;
+std::unordered_map<std::string, unsigned> ScriptWatchdog::overruns_;
+
+// Convert milliseconds to the clock's duration
+static ScriptWatchdog::Clock::duration
+toDuration(float ms) {
+  return std::chrono::duration_cast<ScriptWatchdog::Clock::duration>(
+    std::chrono::duration<float, std::milli>(ms));
+}
+
+// Start the budget, the name is used in reports
+// A coroutine given here is put off until the next frame instead of being stopped
+ScriptWatchdog::Budget::Budget(const char* name, const Limits& limits, lua_State* deferrable)
+  : previous_(current_)
+  , name_(name)
+  , deferrable_(deferrable)
+  , instructionLimit_(std::numeric_limits<unsigned long>::max())
+  , start_(Clock::now())
+  , deadline_(Clock::time_point::max())
+  , isActive_(enabled_)
+  , isFrameTime_(!limits.isLoading) {
+  if (!isActive_) { return; }
+
+  // Zero in the limits means the default, zero in the defaults means no limit
+  const unsigned long instructions = limits.instructions > 0 ? limits.instructions : instructions_;
+  if (instructions > 0) {
+    instructionLimit_ = count_ + instructions;
+  }
+
+  // Only time spent in callbacks counts towards the frame, not physics or loading around them
+  if (Replay::getMode() == Replay::Mode::Off) {
+    const float ms = limits.milliseconds > 0.f ? limits.milliseconds
+      : limits.isLoading ? loadingMilliseconds_ : milliseconds_;
+    if (ms > 0.f) {
+      deadline_ = start_ + toDuration(ms);
+    }
+    if (frameMilliseconds_ > 0.f && isFrameTime_) {
+      deadline_ = std::min(deadline_, start_ + toDuration(std::max(0.f, frameMilliseconds_ - frameSpent_)));
+    }
+  }
+
+  // Callbacks from inside another callback can't outlast it
+  if (previous_ != nullptr && previous_->isActive_) {
+    instructionLimit_ = std::min(instructionLimit_, previous_->instructionLimit_);
+    deadline_ = std::min(deadline_, previous_->deadline_);
+  }
+  current_ = this;
+}
+
+// End the budget, adding its time to the frame if it isn't inside another
+ScriptWatchdog::Budget::~Budget() {
+  if (!isActive_) { return; }
+  current_ = previous_;
+  if (isFrameTime_ && (previous_ == nullptr || !previous_->isActive_)) {
+    frameSpent_ += std::chrono::duration<float, std::milli>(Clock::now() - start_).count();
+  }
+}
+
+// Allow the watchdog and budgets to be configured from Lua
+void
+ScriptWatchdog::registerWatchdogType() {
+
+  // Register the watchdog
+  Game::lua.set("Watchdog", ScriptWatchdog());
+  Game::lua.new_usertype<ScriptWatchdog>("ScriptWatchdog",
+    "enabled", sol::property(
+      &ScriptWatchdog::isEnabled,
+      &ScriptWatchdog::setEnabled),
+    "instructions", sol::property(
+      &ScriptWatchdog::getInstructions,
+      &ScriptWatchdog::setInstructions),
+    "milliseconds", sol::property(
+      &ScriptWatchdog::getMilliseconds,
+      &ScriptWatchdog::setMilliseconds),
+    "frameMilliseconds", sol::property(
+      &ScriptWatchdog::getFrameMilliseconds,
+      &ScriptWatchdog::setFrameMilliseconds),
+    "loadingMilliseconds", sol::property(
+      &ScriptWatchdog::getLoadingMilliseconds,
+      &ScriptWatchdog::setLoadingMilliseconds)
+  );
+
+  // Budgets given to scenes, spells and systems
+  Game::lua.new_usertype<Limits>("ScriptBudget",
+    sol::constructors<Limits()>(),
+    "instructions", &Limits::instructions,
+    "milliseconds", &Limits::milliseconds
+  );
+
+  // Add to auto complete
+  Console::addCommand("[Class] Watchdog");
+  Console::addCommand("Watchdog.enabled");
+  Console::addCommand("Watchdog.instructions");
+  Console::addCommand("Watchdog.milliseconds");
+  Console::addCommand("Watchdog.frameMilliseconds");
+  Console::addCommand("Watchdog.loadingMilliseconds");
+  Console::addCommand("[Class] ScriptBudget");
+  Console::addCommand("ScriptBudget.new");
+
+#if defined(SOL_LUAJIT) && SOL_LUAJIT
+  // Hooks only run in the interpreter
+  Console::log("[Warning] LuaJIT doesn't call hooks from compiled code, the script watchdog can miss loops.");
+#endif
+  updateHook();
+}
+
+// Start or stop enforcing budgets
+void
+ScriptWatchdog::setEnabled(bool enable) {
+  if (enable == enabled_) { return; }
+  enabled_ = enable;
+  updateHook();
+}
+
+// Check if budgets are enforced
+bool
+ScriptWatchdog::isEnabled() {
+  return enabled_;
+}
+
+// Set the default instruction budget of a callback, zero for no limit
+void
+ScriptWatchdog::setInstructions(unsigned long instructions) {
+  instructions_ = instructions;
+}
+
+// Get the default instruction budget of a callback
+unsigned long
+ScriptWatchdog::getInstructions() {
+  return instructions_;
+}
+
+// Set the default time budget of a callback, zero for no limit
+void
+ScriptWatchdog::setMilliseconds(float ms) {
+  milliseconds_ = std::max(0.f, ms);
+}
+
+// Get the default time budget of a callback
+float
+ScriptWatchdog::getMilliseconds() {
+  return milliseconds_;
+}
+
+// Set the time all callbacks in a frame can spend running together, zero for no limit
+void
+ScriptWatchdog::setFrameMilliseconds(float ms) {
+  frameMilliseconds_ = std::max(0.f, ms);
+}
+
+// Get the time all callbacks in a frame can spend running together
+float
+ScriptWatchdog::getFrameMilliseconds() {
+  return frameMilliseconds_;
+}
+
+// Set the default time budget of a loading script, zero for no limit
+void
+ScriptWatchdog::setLoadingMilliseconds(float ms) {
+  loadingMilliseconds_ = std::max(0.f, ms);
+}
+
+// Get the default time budget of a loading script
+float
+ScriptWatchdog::getLoadingMilliseconds() {
+  return loadingMilliseconds_;
+}
+
+// Limits for a one-off script, using the loading defaults
+ScriptWatchdog::Limits
+ScriptWatchdog::getLoadingLimits() {
+  Limits limits;
+  limits.isLoading = true;
+  return limits;
+}
+
+// Install the hook the watchdog and profiler need, or remove it if neither is running
+// Coroutines made after this inherit the hook, ones that already exist update themselves when it's next called
+void
+ScriptWatchdog::updateHook() {
+  const int mask = getMask();
+  lua_sethook(Game::lua.lua_state(), mask != 0 ? &ScriptWatchdog::hook : nullptr, mask, interval);
+}
+
+// Start the frame's budget
+void
+ScriptWatchdog::startFrame() {
+  frameSpent_ = 0.f;
+}
+
+// Show watchdog information in the debug window
+void
+ScriptWatchdog::showDebugInformation() {
+  if (!enabled_) {
+    ImGui::Text("Script Watchdog: Off");
+    return;
+  }
+  ImGui::Text("Script Budget: %.1fms per callback, %.1fms per frame", milliseconds_, frameMilliseconds_);
+  for (const auto& overrun : overruns_) {
+    ImGui::Text("  %s: over budget %u times", overrun.first.c_str(), overrun.second);
+  }
+}
+
+// Called by Lua every interval, and on calls and returns while profiling
+void
+ScriptWatchdog::hook(lua_State* L, lua_Debug* ar) {
+
+  // Coroutines keep the hook they were made with, so bring this one up to date first
+  const int mask = getMask();
+  if (lua_gethookmask(L) != mask) {
+    lua_sethook(L, mask != 0 ? &ScriptWatchdog::hook : nullptr, mask, interval);
+  }
+  if (ar->event == LUA_HOOKCOUNT) {
+    if (enabled_) {
+      count_ += interval;
+      check(L);
+    }
+    return;
+  }
+  if (ScriptProfiler::enabled_) {
+    ScriptProfiler::hook(L, ar);
+  }
+}
+
+// Stop the running callback if it went over budget
+void
+ScriptWatchdog::check(lua_State* L) {
+  Budget* budget = current_;
+  if (budget == nullptr) { return; }
+  const bool isOverInstructions = count_ >= budget->instructionLimit_;
+  if (!isOverInstructions && Clock::now() < budget->deadline_) { return; }
+
+  // Scheduled coroutines can be put off until the next frame where Lua allows yielding from a hook
+  // Any other coroutine belongs to a script, which would see the yield as the coroutine returning
+  bool canDefer = false;
+#if LUA_VERSION_NUM >= 503
+  canDefer = L == budget->deferrable_ && lua_isyieldable(L) != 0;
+#endif
+
+  // Only the first overrun is logged, the rest are counted in the debug window
+  if (overruns_[budget->name_]++ == 0) {
+    Console::log("[Warning] %s went over its %s budget and was %s.", budget->name_,
+      isOverInstructions ? "instruction" : "time",
+      canDefer ? "put off until the next frame" : "stopped");
+  }
+  if (canDefer) {
+    lua_yield(L, 0);
+    return;
+  }
+  luaL_error(L, "%s went over its script budget", budget->name_);
+}
+
+// Get the hook events the watchdog and profiler need
+int
+ScriptWatchdog::getMask() {
+  return (enabled_ ? LUA_MASKCOUNT : 0)
+    | (ScriptProfiler::enabled_ ? LUA_MASKCALL | LUA_MASKRET : 0);
+}
@@ -0,0 +1,140 @@
+// ScriptWatchdog.h
+// Stops Lua callbacks that run over their instruction or time budget
+
+#ifndef SCRIPTWATCHDOG_H
+#define SCRIPTWATCHDOG_H
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+
+#include "Sol.h"
+
+// Static class using Lua's count hook to bound how long each callback into Lua can run
+// Callbacks over budget are aborted with an error, scheduled coroutines are deferred to the next frame where Lua allows it
+// Time budgets differ between machines, so only instructions are counted while recording or replaying
+// @NOTE: Lua has one hook per thread, so this also calls the profiler's hook while it's running
+class ScriptWatchdog {
+  public:
+
+    // Clock used to time budgets
+    typedef std::chrono::steady_clock Clock;
+
+    // Budget of a callback, zero uses the watchdog's default
+    // One-off scripts such as scene setup and resources are loading, they get longer and don't count towards the frame
+    struct Limits {
+      unsigned long instructions = 0;
+      float milliseconds = 0.f;
+      bool isLoading = false;
+    };
+
+    // Marks a C++ function that calls Lua, stopping the script once it goes over budget
+    // Budgets nest, an inner one never outlasts the one it runs in or what's left of the frame's budget
+    class Budget {
+      public:
+
+        // Start the budget, the name is used in reports
+        // A coroutine given here is put off until the next frame instead of being stopped
+        explicit Budget(const char* name, const Limits& limits = Limits(), lua_State* deferrable = nullptr);
+
+        // End the budget
+        ~Budget();
+
+      private:
+
+        // Allow the watchdog to check the budget
+        friend class ScriptWatchdog;
+
+        // The budget this one runs in
+        Budget* previous_;
+
+        // Name used in reports
+        const char* name_;
+
+        // Coroutine that can be deferred
+        lua_State* deferrable_;
+
+        // Instruction count and time to stop at
+        unsigned long instructionLimit_;
+        Clock::time_point start_;
+        Clock::time_point deadline_;
+
+        // Whether the watchdog was running when the budget started
+        bool isActive_;
+
+        // Whether the budget's time counts towards the frame
+        bool isFrameTime_;
+    };
+
+    // Allow the watchdog and budgets to be configured from Lua
+    static void registerWatchdogType();
+
+    // Start or stop enforcing budgets
+    static void setEnabled(bool enable);
+    static bool isEnabled();
+
+    // Default instruction budget of a callback
+    static void setInstructions(unsigned long instructions);
+    static unsigned long getInstructions();
+
+    // Default time budget of a callback in milliseconds
+    static void setMilliseconds(float ms);
+    static float getMilliseconds();
+
+    // Time all callbacks in a frame can spend running together in milliseconds
+    static void setFrameMilliseconds(float ms);
+    static float getFrameMilliseconds();
+
+    // Default time budget of a loading script in milliseconds
+    static void setLoadingMilliseconds(float ms);
+    static float getLoadingMilliseconds();
+
+    // Limits for a one-off script, using the loading defaults
+    static Limits getLoadingLimits();
+
+    // Install the hook the watchdog and profiler need, or remove it if neither is running
+    static void updateHook();
+
+    // Start the frame's budget
+    static void startFrame();
+
+    // Show watchdog information in the debug window
+    static void showDebugInformation();
+
+  private:
+
+    // Instructions run between checks
+    static const int interval = 1000;
+
+    // Called by Lua every interval, and on calls and returns while profiling
+    static void hook(lua_State* L, lua_Debug* ar);
+
+    // Stop the running callback if it went over budget
+    static void check(lua_State* L);
+
+    // Get the hook events the watchdog and profiler need
+    static int getMask();
+
+    // Whether budgets are enforced
+    static bool enabled_;
+
+    // Defaults for callbacks and the frame
+    static unsigned long instructions_;
+    static float milliseconds_;
+    static float frameMilliseconds_;
+    static float loadingMilliseconds_;
+
+    // Instructions run while the hook has been installed
+    static unsigned long count_;
+
+    // Time spent in callbacks this frame in milliseconds
+    static float frameSpent_;
+
+    // Innermost running budget
+    static Budget* current_;
+
+    // Times each callback went over budget
+    static std::unordered_map<std::string, unsigned> overruns_;
+};
+
+#endif
@@ -9,8 +9,11 @@
 #include "Texture.h"
 #include "Font.h"
 #include "Animation.h"
+#include "AnimationSet.h"
 
 #include "Spell.h"
+#include "Scheduler.h"
+#include "Prefab.h"
 
 #include "Transform.h"
 #include "Camera.h"
@@ -52,8 +55,13 @@ Game::lua.new_usertype<TYPE>(NAME, \
 // Handle the initialisation of lua
 void
 Script::startLua() {
-  Console::log("Initialising Lua..");
+#if defined(SOL_LUAJIT) && SOL_LUAJIT
+  Console::log("Initialising Lua (%s)..", LUAJIT_VERSION);
+  Game::lua.open_libraries(sol::lib::base, sol::lib::jit);
+#else
+  Console::log("Initialising Lua (%s)..", LUA_RELEASE);
   Game::lua.open_libraries(sol::lib::base);
+#endif
 
   // COMMON FUNCTIONS
   Game::lua.set("randomInt", &Funcs::randomInt);
@@ -63,26 +71,7 @@ Script::startLua() {
   // Vectors
   Funcs::registerVectors();
   // Rectangles
-  Game::lua.new_usertype<sf::IntRect>("IntRect",
-    sol::constructors<
-      sf::IntRect(), 
-      sf::IntRect(int, int, int, int),
-      sf::IntRect(sf::Vector2i, sf::Vector2i)>(),
-    "left", &sf::IntRect::left,
-    "top", &sf::IntRect::top,
-    "width", &sf::IntRect::width,
-    "height", &sf::IntRect::height
-  );
-  Game::lua.new_usertype<sf::FloatRect>("FloatRect",
-    sol::constructors<
-      sf::FloatRect(), 
-      sf::FloatRect(int, int, int, int),
-      sf::FloatRect(sf::Vector2f, sf::Vector2f)>(),
-    "left", &sf::FloatRect::left,
-    "top", &sf::FloatRect::top,
-    "width", &sf::FloatRect::width,
-    "height", &sf::FloatRect::height
-  );
+  Funcs::registerRects(Game::lua);
   // Time
   Game::lua.set_function("microseconds", &sf::microseconds);
   Game::lua.set_function("milliseconds", &sf::milliseconds);
@@ -125,13 +114,16 @@ Script::startLua() {
 
   // CORE
   ResourceManager::registerResourceTypes();
-  Texture::registerTextureType();
-  Font::registerFontType();
-  Animation::registerAnimationType();
+  Texture::registerTextureType(Game::lua);
+  Font::registerFontType(Game::lua);
+  Animation::registerAnimationType(Game::lua);
+  AnimationSet::registerAnimationSetType(Game::lua);
   Scene::registerSceneType();
 
   // GAME MECHANICS
   Spell::registerSpellType();
+  Scheduler::registerWaitFunctions();
+  Prefab::registerPrefabType();
 
 }
 
@@ -159,6 +151,9 @@ Script::registerSceneFunctions(sol::environment& env, ECS::World* world) {
   Abilities::registerAbilitiesType(env);
   Combat::registerCombatType(env);
 
+  // Spawn prefabs in bulk
+  Prefab::registerSpawnFunction(env, world);
+
   // Register functions that 'turn on' systems in the world
   CameraSystem::registerCameraSystem(env, world);
   PhysicsSystem::registerPhysicsSystem(env, world);
@@ -168,6 +163,7 @@ Script::registerSceneFunctions(sol::environment& env, ECS::World* world) {
   StatSystem::registerStatSystem(env, world);
   CombatSystem::registerCombatSystem(env, world);
   SpellSystem::registerSpellSystem(env, world);
+  ScriptSystem::registerScriptSystem(env, world);
 }
 
 ///////////////////////
@@ -194,6 +190,29 @@ void Script::Funcs::registerVectors() {
   REGISTER_VECTOR(sf::Vector2f, float, "Vector2f");
 }
 
+void Script::Funcs::registerRects(sol::state_view lua) {
+  lua.new_usertype<sf::IntRect>("IntRect",
+    sol::constructors<
+      sf::IntRect(), 
+      sf::IntRect(int, int, int, int),
+      sf::IntRect(sf::Vector2i, sf::Vector2i)>(),
+    "left", &sf::IntRect::left,
+    "top", &sf::IntRect::top,
+    "width", &sf::IntRect::width,
+    "height", &sf::IntRect::height
+  );
+  lua.new_usertype<sf::FloatRect>("FloatRect",
+    sol::constructors<
+      sf::FloatRect(), 
+      sf::FloatRect(int, int, int, int),
+      sf::FloatRect(sf::Vector2f, sf::Vector2f)>(),
+    "left", &sf::FloatRect::left,
+    "top", &sf::FloatRect::top,
+    "width", &sf::FloatRect::width,
+    "height", &sf::FloatRect::height
+  );
+}
+
 void Script::Funcs::registerEvents() {
 
   // Register main event type
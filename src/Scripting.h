@@ -11,6 +11,9 @@
 #include "Sol.h"
 #include "ECS.h"
 #include "Game.h"
+#include "ScriptEvents.h"
+#include "ScriptSystem.h"
+#include "ScriptProxy.h"
 
 // Everything to do with scripting goes in this namespace
 namespace Script {
@@ -39,6 +42,7 @@ namespace Script {
     ////////////////////
     
     void registerVectors();
+    void registerRects(sol::state_view lua);
     void registerEvents();
 
     ////////////////////////////////
@@ -48,7 +52,13 @@ namespace Script {
     // Generic component defaults for Lua
     template <typename T> T& assign(ECS::Entity* e) { return (e->assign<T>(e)).get(); }
     template <typename T> bool has(ECS::Entity* e) { return e->has<T>(); }
-    template <typename T> T& get(ECS::Entity* e) { return (e->get<T>()).get(); }
+    template <typename T> int get(lua_State* L) {
+      auto e = sol::stack::check_get<ECS::Entity*>(L, 1);
+      if (!e || e.value() == nullptr) { return luaL_argerror(L, 1, "expected an Entity"); }
+      auto component = e.value()->get<T>();
+      ScriptProxy::push(L, component.isValid() ? &component.get() : (T*)nullptr);
+      return 1;
+    }
     template <typename T> void remove(ECS::Entity* e) {e->remove<T>();}
   };
 
@@ -58,8 +68,10 @@ namespace Script {
     sol::usertype<ECS::Entity> entityType = Game::lua["Entity"];
     entityType.set("assign" + name, &Funcs::assign<T>);
     entityType.set("has" + name, &Funcs::has<T>);
-    entityType.set("get" + name, &Funcs::get<T>);
+    entityType.set("get" + name, static_cast<lua_CFunction>(&Funcs::get<T>));
     entityType.set("remove" + name, &Funcs::remove<T>);
+    ScriptEvents::registerComponent<T>(name);
+    ScriptSystem::registerComponent<T>(name);
   }
 };
 
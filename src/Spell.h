@@ -6,6 +6,8 @@
 
 #include "Game.h"
 #include "Scripting.h"
+#include "ScriptProfiler.h"
+#include "ScriptWatchdog.h"
 
 // A spell is used to manipulate the game world in some way
 class Spell {
@@ -25,7 +27,8 @@ class Spell {
         "name", &Spell::name_,
         "onCast", &Spell::onCast_,
         "onRelease", &Spell::onRelease_,
-        "onPassive", &Spell::onPassive_
+        "onPassive", &Spell::onPassive_,
+        "budget", &Spell::budget_
       );
     }
 
@@ -40,6 +43,8 @@ class Spell {
     // Casts every frame
     void passive(ECS::Entity* const e, const sf::Time& dt) { 
       if (onPassive_.valid()) {
+        ScriptProfiler::Scope scope("Spell::passive", name_.c_str());
+        ScriptWatchdog::Budget budget(name_.c_str(), budget_);
         auto attempt = onPassive_(e, dt);
         if (!attempt.valid()) {
           sol::error err = attempt;
@@ -61,6 +66,8 @@ class Spell {
 
       // If the script is valid, try to run it
       if (spell.valid()) {
+        ScriptProfiler::Scope scope("Spell::safeCast", name_.c_str());
+        ScriptWatchdog::Budget budget(name_.c_str(), budget_);
         auto attempt = spell(e);
         if (!attempt.valid()) {
           sol::error err = attempt;
@@ -78,6 +85,9 @@ class Spell {
     sol::protected_function onPassive_;
     sol::protected_function onRelease_;
 
+    // How long each cast can run
+    ScriptWatchdog::Limits budget_;
+
 };
 
 #endif
@@ -9,6 +9,7 @@ Sprite::Sprite(ECS::Entity* e, float frameInterval, bool paused, bool looped)
   , lockAnimation(false)
   , flipX(false)
   , flipY(false)
+  , animations_(nullptr)
   , texture_(nullptr)
   , animation_(nullptr)
   , frameTime_(sf::seconds(frameInterval))
@@ -25,26 +26,36 @@ Sprite::Sprite(ECS::Entity* e, float frameInterval, bool paused, bool looped)
 
 // Allow the sprite to be constructed from the resource manager
 bool 
-Sprite::setSpriteFromResources(const std::string& texName) {
+Sprite::setSpriteFromResources(const std::string& texName, bool wait) {
+  return setSpriteFromResources(StringTable::intern(texName), wait);
+}
+
+// Allow the sprite to be constructed from an interned resource name
+bool 
+Sprite::setSpriteFromResources(NameID texName, bool wait) {
 
   // Easy outs
-  if (texName == "") { return false; }
+  if (texName == 0) { return false; }
 
   // Attempts to get the resource
-  Resource& resource = ResourceManager::getResource(texName);
-  if (resource.getType() != Resource::Type::TEXTURE) { 
-    Console::log("[Error] Could not apply sprite: %s\nNonexistant or incorrect resource type.", texName.c_str());
+  ResourceHandle<Texture> handle = ResourceManager::getHandle<Texture>(texName);
+  if (!handle) { 
+    Console::log("[Error] Could not apply sprite: %s\nNonexistant or incorrect resource type.", 
+      StringTable::getString(texName).c_str());
     return false; 
   }
 
-  // Get texture from resource
-  Texture* tex = (Texture*)resource.get();
+  // Get texture from resource, it may still be loading
+  ResourceFuture future = handle.getResource()->getAsync();
+  Texture* tex = (Texture*)(wait ? future.wait() : future.peek());
   if (tex == nullptr) { 
-    Console::log("[Error] Could not apply sprite: %s\nResource is NULL..", texName.c_str());
+    Console::log("[Error] Could not apply sprite: %s\nResource is NULL..", 
+      StringTable::getString(texName).c_str());
     return false; 
   }
 
-  // Set this sprite's texture
+  // Set this sprite's texture, keeping it loaded while in use
+  textureResource_ = handle;
   texture_ = &tex->getTexture();
 
   // Prepare the sprite for drawing
@@ -52,29 +63,38 @@ Sprite::setSpriteFromResources(const std::string& texName) {
   return true;
 }
 
-// Allow the animation to be retrieved from the resource manager
+// Use a shared set of animations from the resource manager
 bool
-Sprite::addAnimationFromResources(const std::string& name, const std::string& animationName) {
+Sprite::setAnimationsFromResources(const std::string& setName) {
+  return setAnimationsFromResources(StringTable::intern(setName));
+}
+
+// Use a shared set of animations by interned name
+bool
+Sprite::setAnimationsFromResources(NameID setName) {
 
   // Easy outs
-  if (name == "" && animationName == "") { return false; }
+  if (setName == 0) { return false; }
 
   // Attempts to get the resource
-  Resource& resource = ResourceManager::getResource(animationName);
-  if (resource.getType() != Resource::Type::ANIMATION) { 
-    Console::log("[Error] Could not add animation: %s\nNonexistant or incorrect resource type.", animationName.c_str());
+  ResourceHandle<AnimationSet> handle = ResourceManager::getHandle<AnimationSet>(setName);
+  if (!handle) { 
+    Console::log("[Error] Could not set animations: %s\nNonexistant or incorrect resource type.", 
+      StringTable::getString(setName).c_str());
     return false; 
   }
 
-  // Get texture from resource
-  const Animation* animation = (Animation*)resource.get();
-  if (animation == nullptr) { 
-    Console::log("[Error] Could not add animation: %s\nResource is NULL..", animationName.c_str());
+  // Get the set from resource
+  const AnimationSet* animations = handle.get();
+  if (animations == nullptr) { 
+    Console::log("[Error] Could not set animations: %s\nResource is NULL..", 
+      StringTable::getString(setName).c_str());
     return false; 
   }
 
-  // Add the animation to the animation map
-  animationMap_[name] = animation;
+  // Every sprite using the set shares it, keeping it loaded while in use
+  animationsResource_ = handle;
+  animations_ = animations;
   return true;
 }
 
@@ -121,26 +141,30 @@ Sprite::play() {
 // Play the given animation
 bool 
 Sprite::playAnimation(const std::string& name, bool restart) {
-  bool success = false;
-  auto it = animationMap_.find(name);
-  if (it != animationMap_.end()) {
-    const Animation* animation = it->second;
-    if (animation != nullptr) {
-      if (animation != animation_) {
-        if (isLooped_) { 
-          play(); 
-          if (restart) { 
-            currentFrame_ = 0; 
-          }
-        }
-        setAnimation(animation);
+  return playAnimation(StringTable::find(name), restart);
+}
+
+// Play the given animation by interned name
+bool 
+Sprite::playAnimation(NameID name, bool restart) {
+
+  // Find the animation in the shared set
+  const Animation* animation = animations_ != nullptr ? animations_->getAnimation(name) : nullptr;
+
+  // Return whether the animation was found
+  if (animation == nullptr) { return false; }
+
+  // Play it
+  if (animation != animation_) {
+    if (isLooped_) { 
+      play(); 
+      if (restart) { 
+        currentFrame_ = 0; 
       }
-      success = true;
     }
+    setAnimation(animation);
   }
-
-  // Return whether the animation was found
-  return success;
+  return true;
 }
 
 // Play an animation with a callback
@@ -321,7 +345,7 @@ void
 Sprite::draw(sf::RenderTarget& target, sf::RenderStates states) const {
   if (texture_ != nullptr) {
     states.transform *= getTransform();
-    states.texture = texture_;
+    states.texture = texture_->getSize().x > 0 ? texture_ : &Texture::getPlaceholder();
     target.draw(vertices_, 4, sf::Quads, states);
   }
 }
@@ -4,19 +4,21 @@
 #ifndef SPRITE_H
 #define SPRITE_H
 
-#include <map>
-
 #include "Game.h"
 #include "Scripting.h"
 
 #include "ResourceManager.h"
 #include "Texture.h"
 #include "Animation.h"
+#include "AnimationSet.h"
 
 // Component used to render an entity
 class Sprite : Component, public sf::Drawable, public sf::Transformable {
   public:
 
+    // Prefabs set up sprites without going through Lua
+    friend class Prefab;
+
     // Make this component scriptable
     static void registerSpriteType(sol::environment& env) {
       
@@ -29,6 +31,10 @@ class Sprite : Component, public sf::Drawable, public sf::Transformable {
         "flipX", &Sprite::flipX,
         "flipY", &Sprite::flipY,
         "size", &Sprite::size_,
+        "getSize", [](const Sprite& self) {
+          return std::make_tuple(self.size_.x, self.size_.y); },
+        "setSize", [](Sprite& self, float x, float y) {
+          self.size_ = sf::Vector2f(x, y); },
         "origin", &Sprite::origin_,
         "scale", &Sprite::scale_,
         "colour", sol::property(
@@ -37,17 +43,20 @@ class Sprite : Component, public sf::Drawable, public sf::Transformable {
         "frameInterval", sol::property(
           &Sprite::getFrameTime,
           &Sprite::setFrameTime),
-        "setSprite", &Sprite::setSpriteFromResources,
+        "setSprite", [](Sprite& self, const sol::object& texture, bool wait) {
+          return self.setSpriteFromResources(StringTable::fromLua(texture), wait); },
         "spritesheetAnchor", &Sprite::spriteSheetAnchor_,
         "updateSprite", &Sprite::updateSprite,
-        "addAnimation", &Sprite::addAnimationFromResources,
+        "setAnimations", [](Sprite& self, const sol::object& animations) {
+          return self.setAnimationsFromResources(StringTable::fromLua(animations)); },
         "loop", sol::property(
           &Sprite::isLooping,
           &Sprite::setLooped),
         "isPlaying", sol::property(&Sprite::isPlaying),
         "updateSprite", &Sprite::updateSprite,
         "setAnimation", &Sprite::setAnimation,
-        "playAnimation", &Sprite::playAnimation,
+        "playAnimation", [](Sprite& self, const sol::object& name, bool restart) {
+          return self.playAnimation(StringTable::fromLua(name), restart); },
         "play", &Sprite::play,
         "pause", &Sprite::pause
       );
@@ -66,10 +75,13 @@ class Sprite : Component, public sf::Drawable, public sf::Transformable {
     bool flipY;
 
     // Allow the sprite to be constructed from the resource manager
-    bool setSpriteFromResources(const std::string& texName);
+    // A placeholder is drawn until the texture has loaded unless we wait
+    bool setSpriteFromResources(const std::string& texName, bool wait = false);
+    bool setSpriteFromResources(NameID texName, bool wait = false);
 
-    // Allow the animation to be retrieved from the resource manager
-    bool addAnimationFromResources(const std::string& actionName, const std::string& animationName);
+    // Use a shared set of animations from the resource manager
+    bool setAnimationsFromResources(const std::string& setName);
+    bool setAnimationsFromResources(NameID setName);
 
     // Get the animation that is currently playing
     const Animation* getAnimation() const;
@@ -89,8 +101,9 @@ class Sprite : Component, public sf::Drawable, public sf::Transformable {
     // Play the currently set animation
     void play();
 
-    // Play the given animation
+    // Play the given animation, interned names avoid a lookup
     bool playAnimation(const std::string& name, bool restart = false);
+    bool playAnimation(NameID name, bool restart = false);
 
     // Play an animation with a callback
     bool playAnimationWithCallback(const std::string& name, std::function<void()> callback);
@@ -139,8 +152,14 @@ class Sprite : Component, public sf::Drawable, public sf::Transformable {
 
   private:
 
-    // Collection of animations
-    std::map<std::string, const Animation*> animationMap_;
+    // Shared animations for each action
+    const AnimationSet* animations_;
+
+    // Keeps the animations loaded while this sprite uses them
+    ResourceHandle<AnimationSet> animationsResource_;
+
+    // Keeps the texture loaded while this sprite uses it
+    ResourceHandle<Texture> textureResource_;
 
     // The texture used by this sprite
     const sf::Texture* texture_;
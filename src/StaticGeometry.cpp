@@ -0,0 +1,504 @@
+// StaticGeometry.cpp
+// Merges static level geometry into a few chain shapes per chunk
+
+#include "StaticGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Avoid cyclic dependencies
+#include "PhysicsSystem.h"
+
+// Directions to walk around a cell: east, south, west, north
+static const int dirX[4] = { 1, 0, -1, 0 };
+static const int dirY[4] = { 0, 1, 0, -1 };
+
+// Divide and round towards negative infinity
+static int
+floorDiv(int a, int b) {
+  return (a >= 0) ? a / b : (a - b + 1) / b;
+}
+
+// Constructor
+StaticGeometry::StaticGeometry(b2World* world, float cellSize, int chunkCells)
+  : world_(world)
+  , cellSize_(cellSize)
+  , chunkCells_(chunkCells)
+  , sourceCount_(0)
+  , hasWarnedUnaligned_(false) {
+}
+
+// Destroy every chunk's body
+StaticGeometry::~StaticGeometry() {
+  clear();
+}
+
+// Add a solid box centred on a position
+// Boxes lined up with the cell grid are merged, others are kept as boxes of their own
+void
+StaticGeometry::addBox(float x, float y, float w, float h) {
+  if (w <= 0.f || h <= 0.f) {
+    Console::log("[Error] Static box at (%.0f, %.0f) has no size.", x, y);
+    return;
+  }
+
+  // Work out which cells the box covers
+  const float tolerance = 0.001f;
+  const float left = (x - w * 0.5f) / cellSize_;
+  const float top = (y - h * 0.5f) / cellSize_;
+  const float right = (x + w * 0.5f) / cellSize_;
+  const float bottom = (y + h * 0.5f) / cellSize_;
+  const int x0 = std::lround(left);
+  const int y0 = std::lround(top);
+  const int x1 = std::lround(right);
+  const int y1 = std::lround(bottom);
+
+  // Snapping would change the shape, so keep the box as it is
+  const bool isAligned = x1 > x0 && y1 > y0
+    && std::abs(left - x0) < tolerance && std::abs(top - y0) < tolerance
+    && std::abs(right - x1) < tolerance && std::abs(bottom - y1) < tolerance;
+  if (!isAligned) {
+    if (!hasWarnedUnaligned_) {
+      Console::log("[Warning] Static box at (%.0f, %.0f) isn't lined up with the %.0fpx cell grid, "
+        "boxes like it won't be merged.", x, y, cellSize_);
+      hasWarnedUnaligned_ = true;
+    }
+    Chunk& chunk = chunks_[getChunkAt(sf::Vector2f(x, y))];
+    chunk.boxes.push_back(sf::FloatRect(x - w * 0.5f, y - h * 0.5f, w, h));
+    chunk.isDirty = true;
+    ++sourceCount_;
+    return;
+  }
+
+  // Fill every cell and mark their chunks as changed
+  for (int cx = x0; cx < x1; ++cx) {
+    for (int cy = y0; cy < y1; ++cy) {
+      cells_.insert(Coord(cx, cy));
+      markCellDirty(cx, cy);
+    }
+  }
+  ++sourceCount_;
+}
+
+// Add a line such as a floor
+void
+StaticGeometry::addEdge(float x1, float y1, float x2, float y2) {
+
+  // Every chunk the edge passes through needs rebuilding
+  std::vector<sf::Vector2f> points;
+  splitAtChunks(sf::Vector2f(x1, y1), sf::Vector2f(x2, y2), points);
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    chunks_[getChunkAt(points[i])].isDirty = true;
+    if (i + 1 < points.size()) {
+      chunks_[getChunkAt((points[i] + points[i + 1]) * 0.5f)].isDirty = true;
+    }
+  }
+  segments_.push_back({ sf::Vector2f(x1, y1), sf::Vector2f(x2, y2) });
+  ++sourceCount_;
+}
+
+// Rebuild any chunks that have changed
+void
+StaticGeometry::build() {
+
+  // Easy out
+  bool isDirty = false;
+  for (const auto& entry : chunks_) {
+    isDirty = isDirty || entry.second.isDirty;
+  }
+  if (!isDirty) { return; }
+
+  // Throw away the old bodies of changed chunks
+  for (auto& entry : chunks_) {
+    Chunk& chunk = entry.second;
+    if (!chunk.isDirty) { continue; }
+    if (chunk.body != nullptr) {
+      world_->DestroyBody(chunk.body);
+      chunk.body = nullptr;
+    }
+    chunk.fixtureCount = 0;
+    for (const auto& box : chunk.boxes) {
+      createBox(chunk, box);
+    }
+  }
+
+  // Outlines are traced over the whole level so shapes crossing chunks aren't cut
+  std::vector<std::vector<Coord>> loops;
+  traceCellLoops(loops);
+  for (const auto& loop : loops) {
+    Path path;
+    path.isLoop = true;
+    for (const auto& p : loop) {
+      path.points.push_back(sf::Vector2f(p.first * cellSize_, p.second * cellSize_));
+    }
+    addPath(path);
+  }
+
+  // Connected edges become chains the same way
+  std::vector<Path> paths;
+  joinSegments(paths);
+  for (const auto& path : paths) {
+    addPath(path);
+  }
+
+  // Everything is up to date
+  for (auto& entry : chunks_) {
+    entry.second.isDirty = false;
+  }
+}
+
+// Remove all geometry
+void
+StaticGeometry::clear() {
+  for (auto& entry : chunks_) {
+    if (entry.second.body != nullptr) {
+      world_->DestroyBody(entry.second.body);
+    }
+  }
+  chunks_.clear();
+  cells_.clear();
+  segments_.clear();
+  sourceCount_ = 0;
+}
+
+// Change the settings used for every fixture
+void
+StaticGeometry::setFixtureDef(const b2FixtureDef& def) {
+  fixtureDef_ = def;
+  fixtureDef_.shape = nullptr;
+
+  // Every chunk needs to pick up the new settings
+  for (auto& entry : chunks_) {
+    entry.second.isDirty = true;
+  }
+}
+
+// Get the size of each grid cell
+float
+StaticGeometry::getCellSize() const {
+  return cellSize_;
+}
+
+// Set the size of each grid cell
+void
+StaticGeometry::setCellSize(float size) {
+  if (sourceCount_ > 0) {
+    Console::log("[Warning] Cannot change the static cell size once geometry has been added.");
+    return;
+  }
+  if (size > 0.f) {
+    cellSize_ = size;
+  }
+}
+
+// Get amount of chunks with geometry
+std::size_t
+StaticGeometry::getChunkCount() const {
+  std::size_t count = 0;
+  for (const auto& entry : chunks_) {
+    count += entry.second.body != nullptr;
+  }
+  return count;
+}
+
+// Get amount of fixtures across all chunks
+std::size_t
+StaticGeometry::getFixtureCount() const {
+  std::size_t count = 0;
+  for (const auto& entry : chunks_) {
+    count += entry.second.fixtureCount;
+  }
+  return count;
+}
+
+// Get amount of boxes and edges that were added
+std::size_t
+StaticGeometry::getSourceCount() const {
+  return sourceCount_;
+}
+
+// Find which chunk a cell belongs to
+StaticGeometry::Coord
+StaticGeometry::getChunkOf(int cx, int cy) const {
+  return Coord(floorDiv(cx, chunkCells_), floorDiv(cy, chunkCells_));
+}
+
+// Find which chunk a point in pixels is in
+StaticGeometry::Coord
+StaticGeometry::getChunkAt(const sf::Vector2f& p) const {
+  const float size = cellSize_ * chunkCells_;
+  return Coord((int)std::floor(p.x / size), (int)std::floor(p.y / size));
+}
+
+// Mark the chunks around a cell as changed, their outlines and ghost vertices may depend on it
+void
+StaticGeometry::markCellDirty(int cx, int cy) {
+  for (int dx = -1; dx <= 1; ++dx) {
+    for (int dy = -1; dy <= 1; ++dy) {
+      chunks_[getChunkOf(cx + dx, cy + dy)].isDirty = true;
+    }
+  }
+}
+
+// Split a line where it crosses chunk borders
+// Crossings right next to an end are skipped, Box2D rejects vertices that close together
+void
+StaticGeometry::splitAtChunks(const sf::Vector2f& a, const sf::Vector2f& b, std::vector<sf::Vector2f>& points) const {
+  const float size = cellSize_ * chunkCells_;
+  const float length = std::sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y));
+  const float minimum = length > 0.f ? 1.f / length : 1.f;
+
+  // Find how far along the line each border is crossed
+  std::vector<float> crossings;
+  auto addCrossings = [&crossings, size, minimum](float from, float to) {
+    if (from == to) { return; }
+    const float low = std::min(from, to);
+    const float high = std::max(from, to);
+    for (float border = (std::floor(low / size) + 1.f) * size; border < high; border += size) {
+      const float t = (border - from) / (to - from);
+      if (t > minimum && t < 1.f - minimum) { crossings.push_back(t); }
+    }
+  };
+  addCrossings(a.x, b.x);
+  addCrossings(a.y, b.y);
+  std::sort(crossings.begin(), crossings.end());
+
+  // Crossing at a chunk's corner counts once
+  points.push_back(a);
+  float last = 0.f;
+  for (float t : crossings) {
+    if (t - last < minimum) { continue; }
+    points.push_back(a + (b - a) * t);
+    last = t;
+  }
+  points.push_back(b);
+}
+
+// Trace the outlines of filled cells into loops of grid points
+void
+StaticGeometry::traceCellLoops(std::vector<std::vector<Coord>>& loops) const {
+  auto isFilled = [this](int x, int y) { return cells_.count(Coord(x, y)) > 0; };
+
+  // Collect every side of a filled cell that faces an empty one
+  // Edges run clockwise around filled areas, keyed by their start point
+  std::multimap<Coord, int> edges;
+  for (const auto& c : cells_) {
+    const int x = c.first, y = c.second;
+    if (!isFilled(x, y - 1)) { edges.insert(std::make_pair(Coord(x, y), 0)); }
+    if (!isFilled(x + 1, y)) { edges.insert(std::make_pair(Coord(x + 1, y), 1)); }
+    if (!isFilled(x, y + 1)) { edges.insert(std::make_pair(Coord(x + 1, y + 1), 2)); }
+    if (!isFilled(x - 1, y)) { edges.insert(std::make_pair(Coord(x, y + 1), 3)); }
+  }
+
+  // Follow edges until they come back round
+  while (!edges.empty()) {
+    auto first = edges.begin();
+    const Coord start = first->first;
+    const int startDir = first->second;
+    int dir = startDir;
+    edges.erase(first);
+
+    // Only corners are kept as vertices
+    std::vector<Coord> loop;
+    loop.push_back(start);
+    Coord current(start.first + dirX[dir], start.second + dirY[dir]);
+    while (current != start) {
+
+      // Prefer turning right so that cells touching at corners are kept apart
+      auto range = edges.equal_range(current);
+      auto next = edges.end();
+      for (int turn : { 1, 0, 3 }) {
+        for (auto it = range.first; it != range.second && next == edges.end(); ++it) {
+          if (it->second == (dir + turn) % 4) { next = it; }
+        }
+      }
+
+      // This shouldn't happen, but avoid looping forever
+      if (next == edges.end()) { break; }
+
+      // Take the edge
+      if (next->second != dir) { loop.push_back(current); }
+      dir = next->second;
+      edges.erase(next);
+      current = Coord(current.first + dirX[dir], current.second + dirY[dir]);
+    }
+
+    // The start is only a corner if the direction changed there
+    if (dir == startDir) { loop.erase(loop.begin()); }
+    if (loop.size() >= 3) { loops.push_back(loop); }
+  }
+}
+
+// Join segments that share end points into chains
+void
+StaticGeometry::joinSegments(std::vector<Path>& paths) const {
+
+  // Snap end points so that nearly identical points are joined
+  auto key = [](const sf::Vector2f& p) { return Coord(std::lround(p.x * 100.f), std::lround(p.y * 100.f)); };
+
+  // Find which segments touch each point
+  const auto& segments = segments_;
+  std::multimap<Coord, std::size_t> ends;
+  for (std::size_t i = 0; i < segments.size(); ++i) {
+    ends.insert(std::make_pair(key(segments[i].a), i));
+    ends.insert(std::make_pair(key(segments[i].b), i));
+  }
+
+  // Start from open ends first, then pick up any closed loops
+  std::vector<bool> used(segments.size(), false);
+  for (int pass = 0; pass < 2; ++pass) {
+    for (std::size_t i = 0; i < segments.size(); ++i) {
+      if (used[i]) { continue; }
+      const bool aIsEnd = ends.count(key(segments[i].a)) != 2;
+      const bool bIsEnd = ends.count(key(segments[i].b)) != 2;
+      if (pass == 0 && !aIsEnd && !bIsEnd) { continue; }
+
+      // Walk away from the open end
+      std::vector<sf::Vector2f> chain;
+      chain.push_back(aIsEnd || !bIsEnd ? segments[i].a : segments[i].b);
+      chain.push_back(aIsEnd || !bIsEnd ? segments[i].b : segments[i].a);
+      used[i] = true;
+      while (ends.count(key(chain.back())) == 2) {
+        auto range = ends.equal_range(key(chain.back()));
+        std::size_t next = segments.size();
+        for (auto it = range.first; it != range.second; ++it) {
+          if (!used[it->second]) { next = it->second; }
+        }
+        if (next == segments.size()) { break; }
+        used[next] = true;
+        const bool forwards = key(segments[next].a) == key(chain.back());
+        chain.push_back(forwards ? segments[next].b : segments[next].a);
+      }
+
+      // Remove points in the middle of straight lines
+      std::vector<sf::Vector2f> merged;
+      for (const auto& p : chain) {
+        if (merged.size() >= 2) {
+          const sf::Vector2f& a = merged[merged.size() - 2];
+          const sf::Vector2f& b = merged.back();
+          const float cross = (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+          if (std::abs(cross) < 0.01f) { merged.pop_back(); }
+        }
+        merged.push_back(p);
+      }
+
+      // Closed chains become loops
+      const bool loop = merged.size() > 3 && key(merged.front()) == key(merged.back());
+      if (loop) { merged.pop_back(); }
+      paths.push_back({ merged, loop });
+    }
+  }
+}
+
+// Split a path into a chain for each chunk it passes through, and add those of changed chunks
+void
+StaticGeometry::addPath(const Path& path) {
+  const std::vector<sf::Vector2f>& original = path.points;
+  if (original.size() < 2) { return; }
+
+  // Break every edge at chunk borders and find which chunk each part is in
+  std::vector<sf::Vector2f> points;
+  std::vector<Coord> owners;
+  const std::size_t edgeCount = path.isLoop ? original.size() : original.size() - 1;
+  for (std::size_t i = 0; i < edgeCount; ++i) {
+    std::vector<sf::Vector2f> split;
+    splitAtChunks(original[i], original[(i + 1) % original.size()], split);
+    for (std::size_t j = 0; j + 1 < split.size(); ++j) {
+      points.push_back(split[j]);
+      owners.push_back(getChunkAt((split[j] + split[j + 1]) * 0.5f));
+    }
+  }
+  if (!path.isLoop) { points.push_back(original.back()); }
+
+  // A loop inside a single chunk stays a loop
+  const std::size_t count = owners.size();
+  if (path.isLoop && std::all_of(owners.begin(), owners.end(), [&owners](const Coord& c) { return c == owners[0]; })) {
+    Chunk& chunk = chunks_[owners[0]];
+    if (chunk.isDirty) { createChain(chunk, original, true); }
+    return;
+  }
+
+  // Start loops where they enter a chunk so no chain wraps round
+  std::size_t start = 0;
+  if (path.isLoop) {
+    while (owners[start] == owners[(start + count - 1) % count]) { ++start; }
+  }
+  const long size = (long)points.size();
+  auto pointAt = [&](long i) -> const sf::Vector2f& {
+    return path.isLoop ? points[((long)start + i + size) % size] : points[i];
+  };
+  auto ownerAt = [&](std::size_t i) -> const Coord& { return owners[(start + i) % count]; };
+
+  // Each run of edges in the same chunk is a chain, joined to its neighbours by ghost vertices
+  for (std::size_t i = 0; i < count; ) {
+    std::size_t j = i;
+    while (j < count && ownerAt(j) == ownerAt(i)) { ++j; }
+    Chunk& chunk = chunks_[ownerAt(i)];
+    if (chunk.isDirty) {
+      std::vector<sf::Vector2f> piece;
+      for (std::size_t k = i; k <= j; ++k) {
+        piece.push_back(pointAt((long)k));
+      }
+      const bool hasPrev = path.isLoop || i > 0;
+      const bool hasNext = path.isLoop || j < count;
+      createChain(chunk, piece, false,
+        hasPrev ? &pointAt((long)i - 1) : nullptr,
+        hasNext ? &pointAt((long)j + 1) : nullptr);
+    }
+    i = j;
+  }
+}
+
+// Get a chunk's body, creating it if needed
+// Every chunk has a single static body with fixtures in world space
+b2Body*
+StaticGeometry::getBody(Chunk& chunk) {
+  if (chunk.body == nullptr) {
+    b2BodyDef def;
+    def.type = b2_staticBody;
+    chunk.body = world_->CreateBody(&def);
+  }
+  return chunk.body;
+}
+
+// Add a chain fixture to a chunk's body, ghost vertices connect it to the chains either side
+void
+StaticGeometry::createChain(Chunk& chunk, const std::vector<sf::Vector2f>& points, bool loop,
+  const sf::Vector2f* prev, const sf::Vector2f* next) {
+
+  // Box2D needs enough points to make a chain
+  if (points.size() < (loop ? 3u : 2u)) { return; }
+  std::vector<b2Vec2> vertices;
+  vertices.reserve(points.size());
+  for (const auto& p : points) {
+    vertices.push_back(PhysicsSystem::convertToB2(p));
+  }
+
+  // Make the shape
+  b2ChainShape shape;
+  if (loop) { shape.CreateLoop(vertices.data(), vertices.size()); }
+  else {
+    shape.CreateChain(vertices.data(), vertices.size());
+    if (prev != nullptr) { shape.SetPrevVertex(PhysicsSystem::convertToB2(*prev)); }
+    if (next != nullptr) { shape.SetNextVertex(PhysicsSystem::convertToB2(*next)); }
+  }
+
+  // Attach it to the chunk
+  b2FixtureDef def = fixtureDef_;
+  def.shape = &shape;
+  getBody(chunk)->CreateFixture(&def);
+  ++chunk.fixtureCount;
+}
+
+// Add a box fixture to a chunk's body
+void
+StaticGeometry::createBox(Chunk& chunk, const sf::FloatRect& box) {
+  const sf::Vector2f centre(box.left + box.width * 0.5f, box.top + box.height * 0.5f);
+  b2PolygonShape shape;
+  shape.SetAsBox(box.width * 0.5f / PhysicsSystem::scale, box.height * 0.5f / PhysicsSystem::scale,
+    PhysicsSystem::convertToB2(centre), 0.f);
+  b2FixtureDef def = fixtureDef_;
+  def.shape = &shape;
+  getBody(chunk)->CreateFixture(&def);
+  ++chunk.fixtureCount;
+}
@@ -0,0 +1,134 @@
+// StaticGeometry.h
+// Merges static level geometry into a few chain shapes per chunk
+
+#ifndef STATICGEOMETRY_H
+#define STATICGEOMETRY_H
+
+#include <map>
+#include <set>
+#include <vector>
+#include <utility>
+
+#include <Box2D/Box2D.h>
+#include <SFML/Graphics.hpp>
+
+// Builds and owns level collision without needing an entity per tile
+// Outlines are traced over the whole level then split at chunk borders with ghost vertices,
+// so bodies slide across chunks without catching on seams
+class StaticGeometry {
+  public:
+
+    // Constructor
+    StaticGeometry(b2World* world, float cellSize = 50.f, int chunkCells = 32);
+
+    // Destroy every chunk's body
+    ~StaticGeometry();
+
+    // Add a solid box centred on a position
+    // Boxes lined up with the cell grid are merged, others are kept as boxes of their own
+    void addBox(float x, float y, float w, float h);
+
+    // Add a line such as a floor
+    void addEdge(float x1, float y1, float x2, float y2);
+
+    // Rebuild any chunks that have changed
+    void build();
+
+    // Remove all geometry
+    void clear();
+
+    // Change the settings used for every fixture
+    void setFixtureDef(const b2FixtureDef& def);
+
+    // Get and set the size of each grid cell in pixels
+    float getCellSize() const;
+    void setCellSize(float size);
+
+    // Statistics for debugging
+    std::size_t getChunkCount() const;
+    std::size_t getFixtureCount() const;
+    std::size_t getSourceCount() const;
+
+  private:
+
+    // Integer coordinates of a cell or chunk
+    typedef std::pair<int, int> Coord;
+
+    // A line added by addEdge, in pixels
+    struct Segment {
+      sf::Vector2f a;
+      sf::Vector2f b;
+    };
+
+    // A chain in pixels, either closed or open
+    struct Path {
+      std::vector<sf::Vector2f> points;
+      bool isLoop;
+    };
+
+    // The body that owns the geometry in an area of the level
+    struct Chunk {
+      std::vector<sf::FloatRect> boxes;
+      b2Body* body = nullptr;
+      std::size_t fixtureCount = 0;
+      bool isDirty = true;
+    };
+
+    // The world to create bodies in
+    b2World* const world_;
+
+    // Size of a cell in pixels
+    float cellSize_;
+
+    // Width and height of a chunk in cells
+    const int chunkCells_;
+
+    // Template for all created fixtures
+    b2FixtureDef fixtureDef_;
+
+    // Filled cells and lines across the whole level
+    std::set<Coord> cells_;
+    std::vector<Segment> segments_;
+
+    // Bodies for each area of the level
+    std::map<Coord, Chunk> chunks_;
+
+    // How many boxes and edges were added
+    std::size_t sourceCount_;
+
+    // Whether boxes off the grid have been warned about
+    bool hasWarnedUnaligned_;
+
+    // Find which chunk a cell belongs to
+    Coord getChunkOf(int cx, int cy) const;
+
+    // Find which chunk a point in pixels is in
+    Coord getChunkAt(const sf::Vector2f& p) const;
+
+    // Mark the chunks around a cell as changed, their outlines and ghost vertices may depend on it
+    void markCellDirty(int cx, int cy);
+
+    // Split a line where it crosses chunk borders
+    void splitAtChunks(const sf::Vector2f& a, const sf::Vector2f& b, std::vector<sf::Vector2f>& points) const;
+
+    // Trace the outlines of filled cells into loops of grid points
+    void traceCellLoops(std::vector<std::vector<Coord>>& loops) const;
+
+    // Join segments that share end points into chains
+    void joinSegments(std::vector<Path>& paths) const;
+
+    // Split a path into a chain for each chunk it passes through, and add those of changed chunks
+    void addPath(const Path& path);
+
+    // Get a chunk's body, creating it if needed
+    b2Body* getBody(Chunk& chunk);
+
+    // Add a chain fixture to a chunk's body, ghost vertices connect it to the chains either side
+    void createChain(Chunk& chunk, const std::vector<sf::Vector2f>& points, bool loop,
+      const sf::Vector2f* prev = nullptr, const sf::Vector2f* next = nullptr);
+
+    // Add a box fixture to a chunk's body
+    void createBox(Chunk& chunk, const sf::FloatRect& box);
+};
+
+#endif
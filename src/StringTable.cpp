@@ -0,0 +1,51 @@
+// StringTable.cpp
+// Interns names so they can be compared and looked up as small integers
+
+#include "StringTable.h"
+
+// Initialise static members, the empty name is always 0
+std::deque<std::string> StringTable::names_ = { "" };
+std::unordered_map<std::string, NameID> StringTable::ids_ = { { "", 0 } };
+std::mutex StringTable::mutex_;
+
+// Get the ID of a name, adding it if it's new
+NameID
+StringTable::intern(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = ids_.find(name);
+  if (it != ids_.end()) { return it->second; }
+  const NameID id = names_.size();
+  names_.push_back(name);
+  ids_[name] = id;
+  return id;
+}
+
+// Get the ID of a name without adding it
+NameID
+StringTable::find(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = ids_.find(name);
+  return it != ids_.end() ? it->second : 0;
+}
+
+// Get the name an ID was made from
+const std::string&
+StringTable::getString(NameID id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return id < names_.size() ? names_[id] : names_[0];
+}
+
+// Get the amount of interned names
+std::size_t
+StringTable::getSize() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return names_.size();
+}
+
+// Resolve a name given from Lua
+NameID
+StringTable::fromLua(const sol::object& name) {
+  if (name.get_type() == sol::type::number) { return name.as<NameID>(); }
+  if (name.get_type() == sol::type::string) { return intern(name.as<std::string>()); }
+  return 0;
+}
@@ -0,0 +1,48 @@
+// StringTable.h
+// Interns names so they can be compared and looked up as small integers
+
+#ifndef STRINGTABLE_H
+#define STRINGTABLE_H
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Sol.h"
+
+// Interned name, 0 is the empty name
+typedef unsigned NameID;
+
+// Static class holding every interned name, safe to use from any thread
+class StringTable {
+  public:
+
+    // Get the ID of a name, adding it if it's new
+    static NameID intern(const std::string& name);
+
+    // Get the ID of a name without adding it, 0 if it's unknown
+    static NameID find(const std::string& name);
+
+    // Get the name an ID was made from
+    static const std::string& getString(NameID id);
+
+    // Get the amount of interned names, IDs are always below this
+    static std::size_t getSize();
+
+    // Resolve a name given from Lua, which may be a string or a pre-resolved ID
+    static NameID fromLua(const sol::object& name);
+
+  private:
+
+    // Names in order of their ID, a deque so returned names stay valid
+    static std::deque<std::string> names_;
+
+    // IDs of every name
+    static std::unordered_map<std::string, NameID> ids_;
+
+    // Protects the table while descriptors are evaluated in parallel
+    static std::mutex mutex_;
+};
+
+#endif
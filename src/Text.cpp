@@ -4,30 +4,39 @@
 #include "Text.h"
 
 // Initialise static variables
-std::string Text::defaultFontName_;
+NameID Text::defaultFont_ = 0;
 
 // Gets a font from the resource manager for this component to use
 bool 
 Text::setFontFromResources(const std::string& fontName) {
+  return setFontFromResources(StringTable::intern(fontName));
+}
+
+// Gets a font by interned name, avoids looking the name up
+bool 
+Text::setFontFromResources(NameID fontName) {
 
   // Easy outs
-  if (fontName == "") { return false; }
+  if (fontName == 0) { return false; }
 
   // Attempts to get the resource
-  Resource& resource = ResourceManager::getResource(fontName);
-  if (resource.getType() != Resource::Type::FONT) { 
-    Console::log("[Error] Could not apply font: %s\nNonexistant or incorrect resource type.", fontName.c_str());
+  ResourceHandle<Font> handle = ResourceManager::getHandle<Font>(fontName);
+  if (!handle) { 
+    Console::log("[Error] Could not apply font: %s\nNonexistant or incorrect resource type.", 
+      StringTable::getString(fontName).c_str());
     return false; 
   }
 
   // Get font from resource
-  Font* font = (Font*)resource.get();
+  Font* font = handle.get();
   if (font == nullptr) { 
-    Console::log("[Error] Could not apply font: %s\nResource is NULL..", fontName.c_str());
+    Console::log("[Error] Could not apply font: %s\nResource is NULL..", 
+      StringTable::getString(fontName).c_str());
     return false; 
   }
 
-  // Set the font of this text
+  // Set the font of this text, keeping it loaded while in use
+  fontResource_ = handle;
   setFont(font->getFont());
   return true;
 }
@@ -48,15 +48,16 @@ class Text : Component, public sf::Text {
           [](Text& self, const sf::Vector2f& origin) { self.setOrigin(origin); }),
         "setRelativeOrigin", &Text::setRelativeOrigin,
         "centerText", &Text::centerText,
-        "setFont", &Text::setFontFromResources
+        "setFont", [](Text& self, const sol::object& font) {
+          return self.setFontFromResources(StringTable::fromLua(font)); }
       );
 
       // Allow access to default font
-      env.set_function("getDefaultFont", []() { return Text::defaultFontName_; } );
+      env.set_function("getDefaultFont", []() { return StringTable::getString(Text::defaultFont_); } );
       env.set_function("setDefaultFont",
-        [](const std::string& f) { 
-          defaultFontName_ = f;
-          Console::log("Default font set to %s", f.c_str()); }
+        [](const sol::object& f) { 
+          defaultFont_ = StringTable::fromLua(f);
+          Console::log("Default font set to %s", StringTable::getString(defaultFont_).c_str()); }
       );
     }
 
@@ -64,12 +65,13 @@ class Text : Component, public sf::Text {
     Text(ECS::Entity* e, const std::string& text = "", const std::string& font = "")
       : Component(e) {
       setString(text);
-      setFontFromResources(font != "" ? font : defaultFontName_);
+      setFontFromResources(font != "" ? StringTable::intern(font) : defaultFont_);
       setRelativeOrigin(0.5f, 0.5f);
     }
 
     // Gets a font from the resource manager for this component to use
     bool setFontFromResources(const std::string& font);
+    bool setFontFromResources(NameID font);
 
     // Sets the origin in relation to size of the text
     void setRelativeOrigin(float x, float y) {
@@ -88,7 +90,10 @@ class Text : Component, public sf::Text {
   private:
 
     // Font to use by default
-    static std::string defaultFontName_;
+    static NameID defaultFont_;
+
+    // Keeps the font loaded while this text uses it
+    ResourceHandle<Font> fontResource_;
 
 };
 
@@ -6,24 +6,75 @@
 
 #include "Game.h"
 #include "Scripting.h"
+#include "AssetPack.h"
 
 // A resource that a Sprite component will use
 class Texture {
   public:
 
     // Allow the Texture type to be made in Lua
-    static void registerTextureType() {
+    static void registerTextureType(sol::state_view lua) {
 
       // Register Texture type
-      Game::lua.new_usertype<Texture>("Texture",
+      lua.new_usertype<Texture>("Texture",
         sol::constructors<Texture(const std::string&)>()
       );
     }
 
-    // Constructor
+    // Constructor, the image isn't loaded until it's needed
     Texture(const std::string& fp)
-      : filepath_(fp) {
-      loadFromFilepath();
+      : filepath_(fp)
+      , packed_(nullptr)
+      , isDecoded_(false) {
+    }
+
+    // Read and decode the image, safe to call from any thread
+    bool decode() {
+
+      // Packed images are already decoded
+      packed_ = AssetPack::find(filepath_);
+      if (packed_ != nullptr && packed_->kind == AssetPack::Kind::IMAGE) {
+        isDecoded_ = true;
+        return true;
+      }
+      packed_ = nullptr;
+      isDecoded_ = image_.loadFromFile(filepath_);
+      return isDecoded_;
+    }
+
+    // Send the decoded image to the GPU, must be called on the main thread
+    void upload() {
+
+      // Packed pixels go straight from the mapped file to the GPU
+      bool success = false;
+      if (isDecoded_ && packed_ != nullptr) {
+        success = texture_.create(packed_->width, packed_->height);
+        if (success) {
+          texture_.update(reinterpret_cast<const sf::Uint8*>(packed_->data));
+        }
+      }
+      else if (isDecoded_) {
+        success = texture_.loadFromImage(image_);
+      }
+      if (!success) {
+        Console::log("[Error] Could not load texture from path: %s", filepath_.c_str());
+      }
+
+      // The image is no longer needed once it's on the GPU
+      image_ = sf::Image();
+      packed_ = nullptr;
+      isDecoded_ = false;
+    }
+
+    // Load the texture straight away
+    void load() {
+      decode();
+      upload();
+    }
+
+    // Get the path of the image
+    const std::string& getFilepath() const {
+      return filepath_;
     }
 
     // Get a pointer to the texture
@@ -31,20 +82,34 @@ class Texture {
       return texture_;
     }
 
+    // Get a texture to draw while the real one is loading
+    static const sf::Texture& getPlaceholder() {
+      static sf::Texture placeholder;
+      if (placeholder.getSize().x == 0) {
+        sf::Image image;
+        image.create(1, 1, sf::Color(255, 255, 255, 64));
+        placeholder.loadFromImage(image);
+        placeholder.setRepeated(true);
+      }
+      return placeholder;
+    }
+
   private:
 
     // Filepath to texture
-    const std::string filepath_;
+    std::string filepath_;
 
     // Texture for this texture to store
     sf::Texture texture_;
 
-    // Load texture from filepath
-    void loadFromFilepath() {
-      if (!texture_.loadFromFile(filepath_)) { 
-        Console::log("[Error] Could not load texture from path: %s", filepath_.c_str());
-      }
-    }
+    // Image decoded from the file, waiting to be uploaded
+    sf::Image image_;
+
+    // Pixels in the asset pack, waiting to be uploaded
+    const AssetPack::Entry* packed_;
+
+    // Whether image_ holds a decoded image
+    bool isDecoded_;
 };
 
 #endif
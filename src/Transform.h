@@ -18,9 +18,20 @@ class Transform : Component {
       Script::registerComponentToEntity<Transform>(env, "Transform");
 
       // Create the Transform usertype
+      // Position can also be read and written as two numbers, which doesn't allocate a vector
       env.new_usertype<Transform>("Transform",
         "position", &Transform::position,
-        "rotation", &Transform::rotation
+        "rotation", &Transform::rotation,
+        "x", sol::property(
+          [](const Transform& self) { return self.position.x; },
+          [](Transform& self, float x) { self.position.x = x; }),
+        "y", sol::property(
+          [](const Transform& self) { return self.position.y; },
+          [](Transform& self, float y) { self.position.y = y; }),
+        "getPosition", [](const Transform& self) {
+          return std::make_tuple(self.position.x, self.position.y); },
+        "setPosition", [](Transform& self, float x, float y) {
+          self.position = sf::Vector2f(x, y); }
       );
     }
 
@@ -1,6 +1,12 @@
 #include "Game.h"
 #include "ResourceManager.h"
 #include "Scene.h"
+#include "Replay.h"
+#include "AssetPack.h"
+#include "ScriptBenchmark.h"
+
+#include <climits>
+#include <cstdlib>
 
 #ifdef linux
 #include <X11/Xlib.h>
@@ -24,8 +30,61 @@ int main(int argc, char* argv[]) {
   else { printf("Error: Failed to call XInitThreads, code %d\n", i); }
 #endif
 
+  // Look for requests to record, replay, pack assets or benchmark scripts
+  std::string recordPath, replayPath, packDir, packPath, benchmarkPath;
+  unsigned benchmarkFrames = 0;
+  for (int i = 1; i + 1 < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--record") { recordPath = argv[++i]; }
+    else if (arg == "--replay") { replayPath = argv[++i]; }
+    else if (arg == "--pack" && i + 2 < argc) { packDir = argv[++i]; packPath = argv[++i]; }
+    else if (arg == "--benchmark-scripts" && i + 2 < argc) { 
+      benchmarkPath = argv[++i]; 
+
+      // A bad frame count is reported rather than thrown
+      const char* frames = argv[++i];
+      char* end = nullptr;
+      const unsigned long count = std::strtoul(frames, &end, 10);
+      if (end == frames || *end != '\0' || frames[0] == '-' || count == 0 || count > UINT_MAX) {
+        printf("Error: Benchmark frame count must be a positive number, got '%s'\n", frames);
+        return 1;
+      }
+      benchmarkFrames = count;
+    }
+  }
+
+  // Packing assets doesn't need the game to run
+  if (!packDir.empty()) {
+    Console::initialise(true);
+    const bool success = AssetPack::build(packDir, packPath);
+    Console::shutdown();
+    return success ? 0 : 1;
+  }
+
+  // Benchmarking scripts doesn't need a window either
+  if (!benchmarkPath.empty()) {
+    Console::initialise(true);
+    const bool success = ScriptBenchmark::run(benchmarkPath, benchmarkFrames);
+    Console::shutdown();
+    return success ? 0 : 1;
+  }
+
+  // Replays run without a window, as fast as possible
+  sf::VideoMode mode(1920, 1080);
+  bool headless = false;
+  if (!replayPath.empty()) {
+    if (Replay::startReplaying(replayPath)) {
+      mode = Replay::getVideoMode();
+      headless = true;
+    }
+    else { printf("Error: Failed to load replay %s\n", replayPath.c_str()); }
+  }
+
   // Initialise and start the game
-  Game::initialise(sf::VideoMode(1920, 1080), "Game", multiThread && multiThreadSuccess);
+  Game::initialise(mode, "Game", multiThread && multiThreadSuccess, headless);
+  if (!recordPath.empty() && !headless) {
+    Replay::startRecording(recordPath, mode);
+  }
   auto& scene = ResourceManager::getResource("BasicScene");
   if (scene.getType() == Resource::Type::SCENE) {
     Game::switchScene((Scene*)scene.get());